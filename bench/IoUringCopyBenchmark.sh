@@ -0,0 +1,104 @@
+#!/usr/bin/env bash
+# Benchmark of the file copies of an installation, with the thread pool alone (-j) against io_uring batches
+#  (-j with --io-uring), on a set of small files (10k x 4 KB) and a set of large files (100 x 200 MB).
+# Only files up to IoUringCopier::MAX_FILE_SIZE (1 MB) are copied through io_uring, the large files are copied
+#  by the usual path (reflink, copy_file_range or sendfile) in both configurations: their set checks that
+#  enabling io_uring costs nothing there, and shows the throughput which the small files are compared to.
+#
+# Usage: bench/IoUringCopyBenchmark.sh <path-to-hansel> [work-dir] [runs]
+#  The work directory (/tmp/hansel-io-uring-bench by default) needs about twice the size of the file sets (~40 GB),
+#  the set sizes can be reduced with SMALL_FILES, SMALL_SIZE_KB, LARGE_FILES and LARGE_SIZE_MB.
+#  THREADS (default: number of cores) and DEPTH (default: 128, which batches IoUringCopier::MAX_FILES_PER_GROUP files)
+#  set the options of Hansel.
+#  When executed as root, the page cache is dropped before each run so that sources are read from the storage.
+
+set -e
+
+if [ $# -lt 1 ] || [ ! -x "$1" ]; then
+    echo "Usage: $0 <path-to-hansel> [work-dir] [runs]" >&2
+    exit 1
+fi
+
+HANSEL=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+WORK_DIR=${2:-/tmp/hansel-io-uring-bench}
+RUNS=${3:-5}
+
+SMALL_FILES=${SMALL_FILES:-10000}
+SMALL_SIZE_KB=${SMALL_SIZE_KB:-4}
+LARGE_FILES=${LARGE_FILES:-100}
+LARGE_SIZE_MB=${LARGE_SIZE_MB:-200}
+THREADS=${THREADS:-$(nproc)}
+DEPTH=${DEPTH:-128}
+
+# Generates a file set (once) and its breadcrumb
+#  Usage: generate_set <name> <file count> <file size in KB>
+generate_set()
+{
+    local set_dir="$WORK_DIR/$1"
+    if [ ! -f "$set_dir/$1.hbc" ]; then
+        echo "Generating $2 files of $3 KB in '$set_dir'..."
+        rm -rf "$set_dir"
+        mkdir -p "$set_dir/files"
+        head -c $(($3 * 1024)) /dev/urandom > "$set_dir/template"
+        for i in $(seq 1 "$2"); do
+            # Each file has its own content, so that the storage can't serve them from the same blocks
+            { printf '%08d' "$i"; tail -c +9 "$set_dir/template"; } > "$set_dir/files/file$i.bin"
+        done
+        rm "$set_dir/template"
+
+        cat > "$set_dir/$1.hbc" <<HBC
+<?xml version="1.0" encoding="UTF-8"?>
+<Breadcrumb FormatVersion="0.1">
+  <Dependencies>
+    <Files Path="./files/*.bin" Destination="\$(OUTPUT_DIR)" />
+  </Dependencies>
+</Breadcrumb>
+HBC
+    fi
+}
+
+# Prints the median wall time (in seconds) of the installation of a set
+#  Usage: measure <name> [options of Hansel]
+measure()
+{
+    local set_name=$1
+    shift
+
+    local times=()
+    for run in $(seq 1 "$RUNS"); do
+        rm -rf "$WORK_DIR/out"
+        sync
+        if [ "$(id -u)" == "0" ]; then
+            echo 3 > /proc/sys/vm/drop_caches
+        fi
+
+        local start end
+        start=$(date +%s.%N)
+        "$HANSEL" --install "$WORK_DIR/$set_name/$set_name.hbc" "$WORK_DIR/out" linux64 \
+            -e OUTPUT_DIR="$WORK_DIR/out" -j "$THREADS" "$@" > /dev/null
+        end=$(date +%s.%N)
+        times+=("$(awk "BEGIN { print $end - $start }")")
+    done
+
+    printf '%s\n' "${times[@]}" | sort -n | awk '{ t[NR] = $1 } END { printf "%.3f", t[int((NR + 1) / 2)] }'
+}
+
+generate_set small "$SMALL_FILES" "$SMALL_SIZE_KB"
+generate_set large "$LARGE_FILES" $((LARGE_SIZE_MB * 1024))
+
+echo
+echo "Median of $RUNS runs, $THREADS threads, io_uring queue depth $DEPTH"
+printf '%-28s %12s %12s\n' "file set" "-j (s)" "--io-uring (s)"
+for set_name in small large; do
+    if [ "$set_name" == "small" ]; then
+        label="$SMALL_FILES x $SMALL_SIZE_KB KB"
+    else
+        label="$LARGE_FILES x $LARGE_SIZE_MB MB"
+    fi
+
+    thread_pool_time=$(measure "$set_name")
+    io_uring_time=$(measure "$set_name" --io-uring "$DEPTH")
+    printf '%-28s %12s %12s\n' "$label" "$thread_pool_time" "$io_uring_time"
+done
+
+rm -rf "$WORK_DIR/out"
@@ -0,0 +1,250 @@
+#include "Breadcrumb.h"
+#include "Logger.h"
+
+#include <tinyxml2/tinyxml2.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+
+namespace Hansel
+{
+    /* Returns true if 'c' is a valid character for a variable name in a placeholder */
+    static bool IsVariableNameCharacter(char c)
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '1' && c <= '9') || c == '_';
+    }
+
+    AttributeTemplate AttributeTemplate::Compile(std::string_view text)
+    {
+        AttributeTemplate attribute_template;
+
+        const auto append_literal = [&attribute_template](std::string_view literal)
+        {
+            if (literal.empty())
+                return;
+            if (!attribute_template.tokens.empty() && !attribute_template.tokens.back().is_variable)
+                attribute_template.tokens.back().text.append(literal);
+            else attribute_template.tokens.push_back(Token{ false, String(literal) });
+        };
+
+        // Scan the text once, splitting it at each $(NAME) placeholder
+        size_t literal_begin = 0;
+        size_t position = text.find("$(");
+        while (position != std::string_view::npos)
+        {
+            size_t name_end = position + 2;
+            while (name_end < text.size() && IsVariableNameCharacter(text[name_end]))
+                name_end++;
+
+            if (name_end == text.size() || text[name_end] != ')')
+            {
+                // Not a placeholder, keep it as literal text
+                position = text.find("$(", position + 1);
+                continue;
+            }
+
+            if (name_end == position + 2)
+            {
+                Logger::Warn("Empty variable placeholder '$()', skipping substitution");
+                position = text.find("$(", name_end);
+                continue;
+            }
+
+            append_literal(text.substr(literal_begin, position - literal_begin));
+
+            // Variables names are always upper-case
+            String variable_name(text.substr(position + 2, name_end - position - 2));
+            for (char& c : variable_name)
+                c = char(std::toupper(static_cast<unsigned char>(c)));
+            attribute_template.tokens.push_back(Token{ true, std::move(variable_name) });
+
+            literal_begin = name_end + 1;
+            position = text.find("$(", literal_begin);
+        }
+
+        append_literal(text.substr(literal_begin));
+
+        return attribute_template;
+    }
+
+    void AttributeTemplate::Instantiate(const ScopedEnvironment& environment, std::string& result, uint32_t depth) const
+    {
+        const size_t begin = result.size();
+        bool has_variables = false;
+
+        for (const Token& token : tokens)
+        {
+            if (!token.is_variable)
+            {
+                result.append(token.text);
+                continue;
+            }
+
+            // Find variable in the environment scopes and get its value
+            const String* value = environment.Find(token.text);
+            if (value == nullptr)
+                throw std::runtime_error(("Cannot substitute $(" + token.text + "), variable not defined").c_str());
+
+            result.append(*value);
+            has_variables = true;
+        }
+
+        // Only the text produced by substituting variables can contain new placeholders
+        if (!has_variables || result.find("$(", begin) == std::string::npos)
+            return;
+
+        const AttributeTemplate expanded_template = Compile(std::string_view(result).substr(begin));
+        if (std::none_of(expanded_template.tokens.begin(), expanded_template.tokens.end(), [](const Token& token) { return token.is_variable; }))
+            return;
+
+        if (depth == MAX_EXPANSION_DEPTH)
+            throw std::runtime_error(("Cannot substitute '" + result.substr(begin) + "', variable values reference each other recursively").c_str());
+
+        result.resize(begin);
+        expanded_template.Instantiate(environment, result, depth + 1);
+    }
+
+
+    const BreadcrumbAttribute* BreadcrumbElement::FindAttribute(const char* attribute_name) const
+    {
+        for (const BreadcrumbAttribute& attribute : attributes)
+        {
+            if (attribute.name == attribute_name)
+                return &attribute;
+        }
+        return nullptr;
+    }
+
+    const char* BreadcrumbElement::Attribute(const char* attribute_name) const
+    {
+        const BreadcrumbAttribute* attribute = FindAttribute(attribute_name);
+        return attribute ? attribute->value.c_str() : nullptr;
+    }
+
+
+    static BreadcrumbElement ConvertXMLElement(const tinyxml2::XMLElement* xml_element)
+    {
+        BreadcrumbElement element;
+        element.name = xml_element->Name();
+        element.line = uint32_t(xml_element->GetLineNum());
+
+        for (const tinyxml2::XMLAttribute* attribute = xml_element->FirstAttribute();
+            attribute != nullptr;
+            attribute = attribute->Next())
+        {
+            element.attributes.emplace_back(attribute->Name(), attribute->Value());
+        }
+
+        for (const tinyxml2::XMLNode* node = xml_element->FirstChild(); node != nullptr; node = node->NextSibling())
+        {
+            const tinyxml2::XMLElement* child_element = node->ToElement();
+            if (child_element)
+                element.children.push_back(ConvertXMLElement(child_element));
+            else element.has_other_children = true;
+        }
+
+        return element;
+    }
+
+    BreadcrumbElement BreadcrumbElement::LoadFromFile(const Path& path)
+    {
+        // Load breadcrumb file and parse XML document
+        tinyxml2::XMLDocument document;
+        document.LoadFile(path.c_str());
+
+        // Check XML parsing errors
+        if (document.Error())
+        {
+            throw std::runtime_error(document.ErrorStr());
+        }
+
+        // Access the top-level <Breadcrumb> node
+        const tinyxml2::XMLElement* breadcrumb_element = document.FirstChildElement("Breadcrumb");
+        if (!breadcrumb_element)
+        {
+            throw std::runtime_error("Invalid breadcrumb file (no top-level <Breadcrumb> element)");
+        }
+
+        return ConvertXMLElement(breadcrumb_element);
+    }
+
+
+    /* The binary form of an element is laid out as follows (all integers are 32-bit, native byte order):
+        [name] [line] [has_other_children] [attribute count] ([name] [value])* [children count] (children)*
+       where each string is encoded as its length followed by its characters (without null terminator). */
+
+    static void WriteUInt32(std::string& buffer, uint32_t value)
+    {
+        buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    static void WriteString(std::string& buffer, const String& str)
+    {
+        WriteUInt32(buffer, uint32_t(str.size()));
+        buffer.append(str);
+    }
+
+    static uint32_t ReadUInt32(const char*& data, const char* end)
+    {
+        if (end - data < std::ptrdiff_t(sizeof(uint32_t)))
+            throw std::runtime_error("Unexpected end of compiled breadcrumb data");
+
+        uint32_t value;
+        std::memcpy(&value, data, sizeof(value));
+        data += sizeof(value);
+        return value;
+    }
+
+    static String ReadString(const char*& data, const char* end)
+    {
+        const uint32_t length = ReadUInt32(data, end);
+        if (end - data < std::ptrdiff_t(length))
+            throw std::runtime_error("Unexpected end of compiled breadcrumb data");
+
+        String str(data, length);
+        data += length;
+        return str;
+    }
+
+    void BreadcrumbElement::Serialize(std::string& buffer) const
+    {
+        WriteString(buffer, name);
+        WriteUInt32(buffer, line);
+        WriteUInt32(buffer, has_other_children ? 1 : 0);
+
+        WriteUInt32(buffer, uint32_t(attributes.size()));
+        for (const auto& attribute : attributes)
+        {
+            WriteString(buffer, attribute.name);
+            WriteString(buffer, attribute.value);
+        }
+
+        WriteUInt32(buffer, uint32_t(children.size()));
+        for (const BreadcrumbElement& child : children)
+            child.Serialize(buffer);
+    }
+
+    BreadcrumbElement BreadcrumbElement::Deserialize(const char*& data, const char* end)
+    {
+        BreadcrumbElement element;
+        element.name = ReadString(data, end);
+        element.line = ReadUInt32(data, end);
+        element.has_other_children = ReadUInt32(data, end) != 0;
+
+        const uint32_t attribute_count = ReadUInt32(data, end);
+        for (uint32_t i = 0; i < attribute_count; i++)
+        {
+            String attribute_name = ReadString(data, end);
+            String attribute_value = ReadString(data, end);
+            element.attributes.emplace_back(std::move(attribute_name), std::move(attribute_value));
+        }
+
+        const uint32_t children_count = ReadUInt32(data, end);
+        for (uint32_t i = 0; i < children_count; i++)
+            element.children.push_back(Deserialize(data, end));
+
+        return element;
+    }
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "Types.h"
+#include "ScopedEnvironment.h"
+
+
+namespace Hansel
+{
+    /* Attribute value pre-compiled into a list of literal segments and $(NAME) variable references,
+        so that it can be instantiated with any set of variable values by simply concatenating segments. */
+    struct AttributeTemplate
+    {
+        struct Token
+        {
+            bool   is_variable;
+            String text;            // literal text, or upper-case variable name
+        };
+
+        std::vector<Token> tokens;
+
+
+        /* Splits the attribute 'text' into literal and variable tokens.
+           Variable placeholders must be of the form $(NAME), where NAME is made of [a-zA-Z1-9_] characters. */
+        static AttributeTemplate Compile(std::string_view text);
+
+        /* Appends the attribute value to 'result', replacing variable references with their value.
+           The substituted text is scanned again as long as it contains placeholders (coming from variable values,
+            or completed by them, e.g. $($(NAME))), like the original regex-based substitution.
+           Throws an std::exception if a referenced variable is not defined in the environment, or if
+            placeholders are still left after 'MAX_EXPANSION_DEPTH' passes (values referencing each other). */
+        void Instantiate(const ScopedEnvironment& environment, std::string& result, uint32_t depth = 0) const;
+
+        static constexpr uint32_t MAX_EXPANSION_DEPTH = 16;
+    };
+
+
+    struct BreadcrumbAttribute
+    {
+        String name;
+        String value;
+        AttributeTemplate value_template;
+
+        BreadcrumbAttribute(String name, String value)
+            : name(std::move(name)), value(std::move(value)), value_template(AttributeTemplate::Compile(this->value))
+        {}
+    };
+
+
+    /* Condition of a <Restrict> element, compiled once from its attributes when the breadcrumb is loaded.
+       All conditions must be satisfied, they are evaluated in the same order as the attributes. */
+    struct RestrictPredicate
+    {
+        struct Condition
+        {
+            enum class Type { OperatingSystem, Architecture, Configuration, Variable };
+
+            Type     type = Type::Variable;
+            uint16_t flags = 0;             // OR'd platform specifier flags
+            String   error{};               // invalid flags are only reported if the condition is evaluated
+            size_t   attribute_index = 0;   // attribute holding the value of a variable test
+            String   variable_name{};       // upper-case
+        };
+
+        std::vector<Condition> conditions;
+    };
+
+
+    /* In-memory representation of an XML element of a breadcrumb file (with all of its descendants).
+       The element tree is decoupled from the XML document, so that it can be loaded either by parsing
+        the breadcrumb file itself or by decoding its compiled (binary) form. */
+    struct BreadcrumbElement
+    {
+        String   name;
+        uint32_t line = 0;
+
+        std::vector<BreadcrumbAttribute> attributes;
+        std::vector<BreadcrumbElement> children;
+
+        // Whether the element contains nodes which are not elements (text, comments), which are not retained
+        bool has_other_children = false;
+
+        // Compiled condition of a <Restrict> element (not part of the serialized form)
+        std::optional<RestrictPredicate> restrict_predicate;
+
+
+        // Returns the attribute with the given name, or nullptr if not present
+        const BreadcrumbAttribute* FindAttribute(const char* attribute_name) const;
+
+        // Returns the value of the attribute with the given name, or nullptr if not present
+        const char* Attribute(const char* attribute_name) const;
+
+        bool NoChildren() const { return children.empty() && !has_other_children; }
+
+
+        /* Parses the XML breadcrumb file at 'path' and returns its top-level <Breadcrumb> element.
+           Throws an std::exception if the file is not a valid XML document or has no <Breadcrumb> element. */
+        static BreadcrumbElement LoadFromFile(const Path& path);
+
+        /* Appends the compact binary representation of this element (and its descendants) to 'buffer'. */
+        void Serialize(std::string& buffer) const;
+
+        /* Decodes an element previously encoded with Serialize(), starting at 'data' and advancing it.
+           Throws an std::exception if the data is truncated or malformed. */
+        static BreadcrumbElement Deserialize(const char*& data, const char* end);
+    };
+}
@@ -0,0 +1,264 @@
+#include "CommandStamps.h"
+#include "Logger.h"
+#include "Utilities.h"
+
+#include <algorithm>
+#include <sstream>
+
+
+namespace Hansel
+{
+    // First line of stamp files, which identifies the version of their layout
+    static constexpr char COMMAND_STAMPS_HEADER[] = "HANSEL-STAMPS 2";
+
+    // Hash of an input which doesn't exist
+    static constexpr uint64_t MISSING_INPUT_HASH = 0;
+
+
+    // 64-bit FNV-1a, the fingerprints only have to change along with the state of the inputs
+    class InputHash
+    {
+    public:
+
+        void Add(const std::string& value)
+        {
+            for (const char c : value)
+                Add(uint8_t(c));
+            Add(uint8_t(0));
+        }
+
+        void Add(uint64_t value)
+        {
+            for (size_t i = 0; i < sizeof(value); i++)
+                Add(uint8_t(value >> (i * 8)));
+        }
+
+        uint64_t Get() const
+        {
+            return (hash != MISSING_INPUT_HASH) ? hash : 1;
+        }
+
+    private:
+
+        void Add(uint8_t byte)
+        {
+            hash = (hash ^ byte) * 0x100000001B3ull;
+        }
+
+        uint64_t hash = 0xCBF29CE484222325ull;
+    };
+
+    static void AddFileInfo(InputHash& hash, const std::filesystem::path& path, const std::filesystem::file_status& status)
+    {
+        std::error_code err;
+        hash.Add(uint64_t(status.type()));
+        if (std::filesystem::is_regular_file(status))
+            hash.Add(uint64_t(std::filesystem::file_size(path, err)));
+        hash.Add(uint64_t(std::filesystem::last_write_time(path, err).time_since_epoch().count()));
+    }
+
+    static uint64_t GetInputHash(const Path& input)
+    {
+        const std::filesystem::path input_path(input);
+
+        std::error_code err;
+        const std::filesystem::file_status status = std::filesystem::status(input_path, err);
+        if (!std::filesystem::exists(status))
+            return MISSING_INPUT_HASH;
+
+        InputHash hash;
+        AddFileInfo(hash, input_path, status);
+        if (!std::filesystem::is_directory(status))
+            return hash.Get();
+
+        // All the files of a directory, in the order of their paths (which doesn't depend on the file system)
+        std::vector<std::pair<std::string, std::filesystem::path>> entries;
+        for (auto it = std::filesystem::recursive_directory_iterator(input_path, err);
+            err.value() == 0 && it != std::filesystem::recursive_directory_iterator(); it.increment(err))
+        {
+            entries.emplace_back(it->path().lexically_relative(input_path).generic_string(), it->path());
+        }
+        std::sort(entries.begin(), entries.end());
+
+        for (const auto& [relative_path, path] : entries)
+        {
+            hash.Add(relative_path);
+            AddFileInfo(hash, path, std::filesystem::status(path, err));
+        }
+        return hash.Get();
+    }
+
+    // Command lines and paths are written with their tabs, line breaks and backslashes escaped
+    static std::string Escape(const std::string& value)
+    {
+        std::string escaped;
+        for (const char c : value)
+        {
+            switch (c)
+            {
+                case '\\':  escaped += "\\\\";  break;
+                case '\t':  escaped += "\\t";   break;
+                case '\n':  escaped += "\\n";   break;
+                case '\r':  escaped += "\\r";   break;
+                default:    escaped += c;       break;
+            }
+        }
+        return escaped;
+    }
+
+    static std::string Unescape(const std::string& value)
+    {
+        std::string unescaped;
+        for (size_t i = 0; i < value.size(); i++)
+        {
+            if (value[i] != '\\' || i + 1 == value.size())
+            {
+                unescaped += value[i];
+                continue;
+            }
+
+            switch (value[++i])
+            {
+                case 't':   unescaped += '\t';      break;
+                case 'n':   unescaped += '\n';      break;
+                case 'r':   unescaped += '\r';      break;
+                default:    unescaped += value[i];  break;
+            }
+        }
+        return unescaped;
+    }
+
+
+    CommandStamps::CommandStamps(const Path& output_directory, bool force)
+        : stamps_path(Utilities::CombinePath(output_directory, ".hansel-stamps"))
+        , force(force)
+    {
+        // A 'C' line with the key of each stamp, followed by an 'I' line with the hash and path of each input
+        Fingerprint* fingerprint = nullptr;
+        const bool is_valid = Utilities::ReadVersionedFile(stamps_path, COMMAND_STAMPS_HEADER, "command stamps file",
+            [this, &fingerprint](const std::vector<std::string>& fields) { return ParseStampLine(fields, fingerprint); });
+        if (!is_valid)
+            stamps.clear();
+    }
+
+    CommandStamps::Fingerprint CommandStamps::GetFingerprint(const std::vector<Path>& inputs)
+    {
+        Fingerprint fingerprint;
+        for (const Path& input : inputs)
+            fingerprint.emplace_back(input, GetInputHash(input));
+        return fingerprint;
+    }
+
+    bool CommandStamps::IsUpToDate(const String& command_line, const Fingerprint& fingerprint,
+        const std::vector<Path>& outputs, String& reason)
+    {
+        const String key = GetStampKey(command_line, fingerprint, outputs);
+        current_commands.insert(key);
+
+        // The key includes the paths of the inputs, a stamp with the same key has the same number of them
+        const auto it = stamps.find(key);
+        if (force)
+            reason = "all commands are executed with --force";
+        else if (it == stamps.end() || it->second.size() != fingerprint.size())
+            reason = "it has not completed successfully before (with the same command line, inputs and outputs)";
+        else
+        {
+            for (size_t i = 0; i < fingerprint.size() && reason.empty(); i++)
+            {
+                if (fingerprint[i].second == MISSING_INPUT_HASH)
+                    reason = std::format("input '{}' doesn't exist", fingerprint[i].first);
+                else if (fingerprint[i].second != it->second[i].second)
+                    reason = std::format("input '{}' has changed", fingerprint[i].first);
+            }
+
+            for (size_t i = 0; i < outputs.size() && reason.empty(); i++)
+            {
+                std::error_code err;
+                if (!std::filesystem::exists(std::filesystem::path(outputs[i]), err))
+                    reason = std::format("output '{}' doesn't exist", outputs[i]);
+            }
+        }
+
+        if (!reason.empty())
+            return false;
+
+        skipped_commands++;
+        return true;
+    }
+
+    void CommandStamps::Record(const String& command_line, const Fingerprint& fingerprint, const std::vector<Path>& outputs,
+        bool succeeded)
+    {
+        executed_commands++;
+
+        const String key = GetStampKey(command_line, fingerprint, outputs);
+        if (succeeded)
+            stamps.insert_or_assign(key, fingerprint);
+        else
+            stamps.erase(key);
+    }
+
+    void CommandStamps::Save() const
+    {
+        if (stamps.empty() && !std::filesystem::exists(std::filesystem::path(stamps_path)))
+            return;     // nothing to record, and no stamps to remove
+
+        std::stringstream buffer;
+        buffer << COMMAND_STAMPS_HEADER << '\n';
+        for (const auto& [key, fingerprint] : stamps)
+        {
+            if (!current_commands.contains(key))
+                continue;
+
+            buffer << "C\t" << Escape(key) << '\n';
+            for (const auto& [input, hash] : fingerprint)
+                buffer << "I\t" << std::hex << hash << std::dec << '\t' << Escape(input) << '\n';
+        }
+
+        const std::error_code err = Utilities::WriteFileAtomically(stamps_path, buffer.str());
+        if (err.value() != 0)
+            Logger::Warn("Unable to write the command stamps '{}' ({})", stamps_path, err.message());
+    }
+
+    String CommandStamps::GetStampKey(const String& command_line, const Fingerprint& fingerprint, const std::vector<Path>& outputs)
+    {
+        // Line breaks are escaped in stamp files, so they can separate the parts of the key
+        String key = command_line;
+        for (const auto& [input, hash] : fingerprint)
+            key += "\nI " + input;
+        for (const Path& output : outputs)
+            key += "\nO " + output;
+        return key;
+    }
+
+    bool CommandStamps::ParseStampLine(const std::vector<std::string>& fields, Fingerprint*& fingerprint)
+    {
+        if (fields.size() == 2 && fields[0] == "C")
+        {
+            fingerprint = &stamps[Unescape(fields[1])];
+            fingerprint->clear();
+            return true;
+        }
+
+        if (fields.size() != 3 || fields[0] != "I" || !fingerprint)
+            return false;
+
+        uint64_t hash = 0;
+        try
+        {
+            hash = std::stoull(fields[1], nullptr, 16);
+        }
+        catch (const std::exception&)
+        {
+            return false;   // not a number, or out of range
+        }
+
+        fingerprint->emplace_back(Unescape(fields[2]), hash);
+        return true;
+    }
+
+    void CommandStamps::PrintStatistics() const
+    {
+        Logger::InfoVerbose("Command stamps: {} commands up-to-date, {} executed", skipped_commands, executed_commands);
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "Types.h"
+
+#include <unordered_map>
+#include <unordered_set>
+
+
+namespace Hansel
+{
+    /* Record of the commands and scripts which have completed successfully in an output directory, stored in
+        the directory itself (.hansel-stamps), for those which declare their inputs or outputs.
+       The stamp of a command is keyed by its command line (which includes the substituted arguments) together with
+        its declared inputs and outputs, and holds the fingerprint which its inputs had when it was started: the size
+        and modification time of each file, of all the files inside for directories. A later installation skips the
+        command if the fingerprint of its inputs is still the same and all of its outputs still exist.
+       Only the stamps of the commands which are part of the current installation are kept. */
+    class CommandStamps
+    {
+    public:
+
+        // Hash of the state of each input of a command, in the order in which they are declared
+        using Fingerprint = std::vector<std::pair<Path, uint64_t>>;
+
+        /* Loads the stamps of 'output_directory', if there is a valid file.
+           With 'force', commands are never considered up-to-date but their stamps are still updated. */
+        CommandStamps(const Path& output_directory, bool force);
+
+        static Fingerprint GetFingerprint(const std::vector<Path>& inputs);
+
+        /* Returns true if the command has already completed successfully with the same fingerprint, and all of its
+            outputs still exist; otherwise 'reason' explains why it must be executed. */
+        bool IsUpToDate(const String& command_line, const Fingerprint& fingerprint, const std::vector<Path>& outputs, String& reason);
+
+        // Records the result of the command, a command which has failed is executed again by the next installation
+        void Record(const String& command_line, const Fingerprint& fingerprint, const std::vector<Path>& outputs, bool succeeded);
+
+        // Writes the stamps back to the output directory, replacing the previous ones
+        void Save() const;
+
+        // Prints the number of commands which have been skipped and executed (verbose only)
+        void PrintStatistics() const;
+
+    private:
+
+        // Returns the key of the stamp of a command, made of its command line and of the paths of its inputs and outputs
+        static String GetStampKey(const String& command_line, const Fingerprint& fingerprint, const std::vector<Path>& outputs);
+
+        // Adds the line of a stamp file to the stamps ('fingerprint' is the one of the last stamp), returns false if it's not valid
+        bool ParseStampLine(const std::vector<std::string>& fields, Fingerprint*& fingerprint);
+
+        const Path stamps_path;
+        const bool force;
+
+        std::unordered_map<String, Fingerprint> stamps;
+        std::unordered_set<String> current_commands;   // keys of the stamps
+
+        uint32_t skipped_commands = 0;
+        uint32_t executed_commands = 0;
+    };
+}
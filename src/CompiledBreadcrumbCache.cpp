@@ -0,0 +1,218 @@
+#include "CompiledBreadcrumbCache.h"
+#include "FileSystemCache.h"
+#include "Logger.h"
+#include "Utilities.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <Windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+
+namespace Hansel
+{
+    // Identifies compiled breadcrumb files, and the version of their binary layout
+    static constexpr char     COMPILED_BREADCRUMB_MAGIC[4] = { 'H', 'B', 'C', 'C' };
+    static constexpr uint32_t COMPILED_BREADCRUMB_FORMAT = 1;
+
+
+    /* Read-only memory mapping of an entire file, the view is released on destruction. */
+    class MappedFile
+    {
+    public:
+
+        explicit MappedFile(const Path& path)
+        {
+#ifdef _WIN32
+            file = CreateFileW(std::filesystem::path(path).c_str(), GENERIC_READ, FILE_SHARE_READ,
+                nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file == INVALID_HANDLE_VALUE)
+                return;
+
+            LARGE_INTEGER file_size;
+            if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+                return;
+
+            mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            if (mapping == nullptr)
+                return;
+
+            data = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            if (data != nullptr)
+                size = size_t(file_size.QuadPart);
+#else
+            file = open(path.c_str(), O_RDONLY);
+            if (file < 0)
+                return;
+
+            struct stat file_stat;
+            if (fstat(file, &file_stat) != 0 || file_stat.st_size == 0)
+                return;
+
+            void* view = mmap(nullptr, size_t(file_stat.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+            if (view != MAP_FAILED)
+            {
+                data = static_cast<const char*>(view);
+                size = size_t(file_stat.st_size);
+            }
+#endif
+        }
+
+        ~MappedFile()
+        {
+#ifdef _WIN32
+            if (data != nullptr)
+                UnmapViewOfFile(data);
+            if (mapping != nullptr)
+                CloseHandle(mapping);
+            if (file != INVALID_HANDLE_VALUE)
+                CloseHandle(file);
+#else
+            if (data != nullptr)
+                munmap(const_cast<char*>(data), size);
+            if (file >= 0)
+                close(file);
+#endif
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        const char* Begin() const { return data; }
+        const char* End() const { return data + size; }
+        bool IsValid() const { return data != nullptr; }
+
+    private:
+
+#ifdef _WIN32
+        HANDLE file = INVALID_HANDLE_VALUE;
+        HANDLE mapping = nullptr;
+#else
+        int file = -1;
+#endif
+        const char* data = nullptr;
+        size_t size = 0;
+    };
+
+
+    BreadcrumbElement CompiledBreadcrumbCache::Load(const Path& path_to_breadcrumb, const Path& cache_directory, const Version& parser_version)
+    {
+        SourceInfo source;
+        try
+        {
+            source.path = FileSystemCache::Canonical(path_to_breadcrumb);
+            source.size = std::filesystem::file_size(path_to_breadcrumb);
+            source.modification_time = int64_t(std::filesystem::last_write_time(path_to_breadcrumb).time_since_epoch().count());
+        }
+        catch (const std::exception&)
+        {
+            // Without a reliable key the cache cannot be used, fall back to parsing the breadcrumb file directly
+            return BreadcrumbElement::LoadFromFile(path_to_breadcrumb);
+        }
+
+        const Path compiled_path = GetCompiledBreadcrumbPath(cache_directory, source.path);
+
+        std::optional<BreadcrumbElement> breadcrumb = ReadCompiledBreadcrumb(compiled_path, source, parser_version);
+        if (breadcrumb.has_value())
+        {
+            s_Hits++;
+            return std::move(breadcrumb.value());
+        }
+
+        s_Misses++;
+        BreadcrumbElement parsed_breadcrumb = BreadcrumbElement::LoadFromFile(path_to_breadcrumb);
+        WriteCompiledBreadcrumb(compiled_path, source, parser_version, parsed_breadcrumb);
+        return parsed_breadcrumb;
+    }
+
+    void CompiledBreadcrumbCache::PrintStatistics()
+    {
+        Logger::InfoVerbose("Compiled breadcrumb cache: {} hits, {} misses", s_Hits.load(), s_Misses.load());
+    }
+
+
+    std::optional<BreadcrumbElement> CompiledBreadcrumbCache::ReadCompiledBreadcrumb(const Path& compiled_path,
+        const SourceInfo& source, const Version& parser_version)
+    {
+        const MappedFile file(compiled_path);
+        if (!file.IsValid())
+            return std::optional<BreadcrumbElement>(std::nullopt);
+
+        const char* data = file.Begin();
+        const char* const end = file.End();
+
+        try
+        {
+            // Any mismatch in the header means that the compiled breadcrumb is stale
+            if (end - data < std::ptrdiff_t(sizeof(COMPILED_BREADCRUMB_MAGIC)) ||
+                std::memcmp(data, COMPILED_BREADCRUMB_MAGIC, sizeof(COMPILED_BREADCRUMB_MAGIC)) != 0)
+                return std::optional<BreadcrumbElement>(std::nullopt);
+            data += sizeof(COMPILED_BREADCRUMB_MAGIC);
+
+            uint32_t header[4];
+            uint64_t size;
+            int64_t modification_time;
+            uint32_t path_length;
+            if (end - data < std::ptrdiff_t(sizeof(header) + sizeof(size) + sizeof(modification_time) + sizeof(path_length)))
+                return std::optional<BreadcrumbElement>(std::nullopt);
+
+            std::memcpy(header, data, sizeof(header));                          data += sizeof(header);
+            std::memcpy(&size, data, sizeof(size));                             data += sizeof(size);
+            std::memcpy(&modification_time, data, sizeof(modification_time));   data += sizeof(modification_time);
+            std::memcpy(&path_length, data, sizeof(path_length));               data += sizeof(path_length);
+
+            if (header[0] != COMPILED_BREADCRUMB_FORMAT ||
+                header[1] != parser_version.major || header[2] != parser_version.minor || header[3] != parser_version.patch ||
+                size != source.size || modification_time != source.modification_time ||
+                end - data < std::ptrdiff_t(path_length) || Path(data, path_length) != source.path)
+                return std::optional<BreadcrumbElement>(std::nullopt);
+            data += path_length;
+
+            return BreadcrumbElement::Deserialize(data, end);
+        }
+        catch (const std::exception&)
+        {
+            Logger::WarnVerbose("The compiled breadcrumb '{}' is corrupted and will be re-generated", compiled_path);
+            return std::optional<BreadcrumbElement>(std::nullopt);
+        }
+    }
+
+    void CompiledBreadcrumbCache::WriteCompiledBreadcrumb(const Path& compiled_path, const SourceInfo& source,
+        const Version& parser_version, const BreadcrumbElement& breadcrumb)
+    {
+        std::string buffer(COMPILED_BREADCRUMB_MAGIC, sizeof(COMPILED_BREADCRUMB_MAGIC));
+
+        const uint32_t header[4] = { COMPILED_BREADCRUMB_FORMAT, parser_version.major, parser_version.minor, parser_version.patch };
+        const uint32_t path_length = uint32_t(source.path.size());
+        buffer.append(reinterpret_cast<const char*>(header), sizeof(header));
+        buffer.append(reinterpret_cast<const char*>(&source.size), sizeof(source.size));
+        buffer.append(reinterpret_cast<const char*>(&source.modification_time), sizeof(source.modification_time));
+        buffer.append(reinterpret_cast<const char*>(&path_length), sizeof(path_length));
+        buffer.append(source.path);
+
+        breadcrumb.Serialize(buffer);
+
+        const std::error_code err = Utilities::WriteFileAtomically(compiled_path, buffer);
+        if (err.value() != 0)
+            Logger::WarnVerbose("Unable to write the compiled breadcrumb '{}' ({})", compiled_path, err.message());
+    }
+
+
+    Path CompiledBreadcrumbCache::GetCompiledBreadcrumbPath(const Path& cache_directory, const Path& canonical_path)
+    {
+        // Compiled breadcrumbs are named after the original file, plus the hash of its full path to avoid collisions
+        char hash_str[17];
+        std::snprintf(hash_str, sizeof(hash_str), "%016llx", (unsigned long long)Utilities::HashString(canonical_path));
+
+        const std::string stem = std::filesystem::path(canonical_path).stem().string();
+        return Utilities::CombinePath(cache_directory, stem + '-' + hash_str + ".hbcc");
+    }
+}
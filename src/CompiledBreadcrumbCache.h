@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Breadcrumb.h"
+
+#include <atomic>
+
+
+namespace Hansel
+{
+    class CompiledBreadcrumbCache
+    {
+    public:
+
+        /* Returns the element tree of the breadcrumb file at 'path_to_breadcrumb'.
+           If 'cache_directory' contains a compiled (.hbcc) version of the breadcrumb which matches the
+            current size and modification time of the file and the given parser version, the element tree
+            is decoded from it without parsing the XML document at all; otherwise the breadcrumb is parsed
+            and its compiled form is (re-)written to the cache directory for the next executions.
+           Throws an std::exception if the breadcrumb file cannot be parsed. */
+        static BreadcrumbElement Load(const Path& path_to_breadcrumb, const Path& cache_directory, const Version& parser_version);
+
+        // Prints the number of cache hits and misses (verbose only)
+        static void PrintStatistics();
+
+    private:
+
+        struct SourceInfo
+        {
+            Path     path;
+            uint64_t size;
+            int64_t  modification_time;
+        };
+
+        static std::optional<BreadcrumbElement> ReadCompiledBreadcrumb(const Path& compiled_path,
+            const SourceInfo& source, const Version& parser_version);
+        static void WriteCompiledBreadcrumb(const Path& compiled_path, const SourceInfo& source,
+            const Version& parser_version, const BreadcrumbElement& breadcrumb);
+
+        static Path GetCompiledBreadcrumbPath(const Path& cache_directory, const Path& canonical_path);
+
+        inline static std::atomic<uint32_t> s_Hits = 0;
+        inline static std::atomic<uint32_t> s_Misses = 0;
+    };
+}
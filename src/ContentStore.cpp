@@ -0,0 +1,394 @@
+#include "ContentStore.h"
+#include "FileCopier.h"
+#include "Logger.h"
+#include "Utilities.h"
+
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+
+namespace Hansel
+{
+    // First line of index files, which identifies the version of their layout
+    static constexpr char CONTENT_STORE_HEADER[] = "HANSEL-STORE 1";
+
+
+    /* Incremental SHA-256 digest (FIPS 180-4). */
+    class Sha256
+    {
+    public:
+
+        void Update(const unsigned char* data, size_t size)
+        {
+            total_size += size;
+            while (size > 0)
+            {
+                // Whole blocks are processed in place, without going through the block buffer
+                if (block_size == 0 && size >= block.size())
+                {
+                    Transform(data);
+                    data += block.size();
+                    size -= block.size();
+                    continue;
+                }
+
+                const size_t length = std::min(size, block.size() - block_size);
+                std::memcpy(block.data() + block_size, data, length);
+                block_size += length;
+                data += length;
+                size -= length;
+
+                if (block_size == block.size())
+                {
+                    Transform(block.data());
+                    block_size = 0;
+                }
+            }
+        }
+
+        // Returns the digest as a lowercase hexadecimal string
+        std::string Finish()
+        {
+            // Pad with a single bit, then zeros up to the last 8 bytes of a block, which hold the size in bits
+            const uint64_t total_bits = total_size * 8;
+            const unsigned char padding_start = 0x80;
+            Update(&padding_start, 1);
+
+            const unsigned char zero = 0;
+            while (block_size != block.size() - 8)
+                Update(&zero, 1);
+
+            for (int shift = 56; shift >= 0; shift -= 8)
+            {
+                const unsigned char size_byte = static_cast<unsigned char>(total_bits >> shift);
+                Update(&size_byte, 1);
+            }
+
+            char hash_str[65];
+            for (size_t i = 0; i < state.size(); i++)
+                std::snprintf(hash_str + i * 8, 9, "%08x", state[i]);
+            return std::string(hash_str, 64);
+        }
+
+    private:
+
+        static uint32_t RotateRight(uint32_t value, int bits)
+        {
+            return (value >> bits) | (value << (32 - bits));
+        }
+
+        void Transform(const unsigned char* data)
+        {
+            static constexpr std::array<uint32_t, 64> ROUND_CONSTANTS = {
+                0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+                0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+                0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+                0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+                0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+                0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+                0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+                0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+            };
+
+            std::array<uint32_t, 64> words;
+            for (size_t i = 0; i < 16; i++)
+            {
+                words[i] = (uint32_t(data[i * 4]) << 24) | (uint32_t(data[i * 4 + 1]) << 16) |
+                    (uint32_t(data[i * 4 + 2]) << 8) | uint32_t(data[i * 4 + 3]);
+            }
+            for (size_t i = 16; i < 64; i++)
+            {
+                const uint32_t s0 = RotateRight(words[i - 15], 7) ^ RotateRight(words[i - 15], 18) ^ (words[i - 15] >> 3);
+                const uint32_t s1 = RotateRight(words[i - 2], 17) ^ RotateRight(words[i - 2], 19) ^ (words[i - 2] >> 10);
+                words[i] = words[i - 16] + s0 + words[i - 7] + s1;
+            }
+
+            uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+            uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+            for (size_t i = 0; i < 64; i++)
+            {
+                const uint32_t s1 = RotateRight(e, 6) ^ RotateRight(e, 11) ^ RotateRight(e, 25);
+                const uint32_t choice = (e & f) ^ (~e & g);
+                const uint32_t temp1 = h + s1 + choice + ROUND_CONSTANTS[i] + words[i];
+                const uint32_t s0 = RotateRight(a, 2) ^ RotateRight(a, 13) ^ RotateRight(a, 22);
+                const uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+                const uint32_t temp2 = s0 + majority;
+
+                h = g; g = f; f = e;
+                e = d + temp1;
+                d = c; c = b; b = a;
+                a = temp1 + temp2;
+            }
+
+            state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+            state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+        }
+
+        std::array<uint32_t, 8> state = {
+            0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+        };
+        std::array<unsigned char, 64> block = {};
+        size_t block_size = 0;
+        uint64_t total_size = 0;
+    };
+
+
+    ContentStore::ContentStore(const Path& store_directory)
+        : store_directory(store_directory)
+        , index_path(Utilities::CombinePath(store_directory, "index"))
+    {
+        std::error_code err;
+        std::filesystem::create_directories(std::filesystem::path(store_directory), err);
+
+        // One tab-separated line per source file (S, path, size, modification time and hash)
+        //  and per object (O, name, size and modification time when it has been added or verified)
+        const bool is_valid = Utilities::ReadVersionedFile(index_path, CONTENT_STORE_HEADER, "content store index",
+            [this](const std::vector<std::string>& fields) { return ParseIndexEntry(fields); });
+        if (!is_valid)
+        {
+            sources.clear();
+            objects.clear();
+        }
+    }
+
+    std::error_code ContentStore::Install(const Path& source, const Path& destination)
+    {
+        // Files which can't be inspected are copied directly, which reports the error as usual
+        const std::optional<FileInfo> source_info = Utilities::GetFileInfo(source);
+        if (!source_info.has_value())
+            return FileCopier::Copy(source, destination);
+
+        std::error_code err;
+        const std::string hash = GetSourceHash(source, source_info.value(), err);
+        if (err.value() != 0)
+            return err;
+
+        const std::filesystem::perms permissions = std::filesystem::status(std::filesystem::path(source), err).permissions();
+        if (err.value() != 0)
+            return err;
+
+        // Files with the same content but different permissions are different objects, since hard links share them
+        char permissions_str[8];
+        std::snprintf(permissions_str, sizeof(permissions_str), "%04o",
+            static_cast<unsigned int>(permissions & std::filesystem::perms::mask));
+        const std::string object_name = hash + '-' + permissions_str;
+
+        err = AddObject(source, source_info.value(), object_name, hash);
+        if (err == std::errc::interrupted)
+        {
+            // The source has changed while it was being added, so it's copied directly this time
+            copied_files++;
+            return FileCopier::Copy(source, destination);
+        }
+        if (err.value() != 0)
+            return err;
+
+        return PlaceObject(GetObjectPath(object_name), destination);
+    }
+
+    void ContentStore::Save() const
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+
+        std::stringstream buffer;
+        buffer << CONTENT_STORE_HEADER << '\n';
+        for (const auto& [path, entry] : sources)
+            buffer << "S\t" << path << '\t' << entry.info.size << '\t' << entry.info.modification_time << '\t' << entry.hash << '\n';
+        for (const auto& [name, info] : objects)
+            buffer << "O\t" << name << '\t' << info.size << '\t' << info.modification_time << '\n';
+
+        const std::error_code err = Utilities::WriteFileAtomically(index_path, buffer.str());
+        if (err.value() != 0)
+            Logger::Warn("Unable to write the content store index '{}' ({})", index_path, err.message());
+    }
+
+    void ContentStore::PrintStatistics() const
+    {
+        Logger::InfoVerbose("Content store: {} files hashed ({} MB), {} hashes reused, {} objects added and {} reused, "
+            "{} files reflinked, {} hard-linked and {} copied", hashed_files.load(), hashed_bytes.load() / (1024 * 1024),
+            reused_hashes.load(), added_objects.load(), reused_objects.load(),
+            reflinked_files.load(), hard_linked_files.load(), copied_files.load());
+    }
+
+
+    bool ContentStore::ParseIndexEntry(const std::vector<std::string>& fields)
+    {
+        const bool is_source = fields.size() == 5 && fields[0] == "S";
+        const bool is_object = fields.size() == 4 && fields[0] == "O";
+        if (!is_source && !is_object)
+            return false;
+
+        FileInfo info;
+        try
+        {
+            info = FileInfo{ std::stoull(fields[2]), std::stoll(fields[3]) };
+        }
+        catch (const std::exception&)
+        {
+            return false;   // not a number, or out of range
+        }
+
+        if (is_source)
+            sources.insert_or_assign(fields[1], SourceEntry{ info, fields[4] });
+        else
+            objects.insert_or_assign(fields[1], info);
+        return true;
+    }
+
+    std::string ContentStore::HashFile(const Path& path, std::error_code& err)
+    {
+        std::ifstream stream(std::filesystem::path(path), std::ios::binary);
+        if (!stream)
+        {
+            err = std::make_error_code(std::errc::no_such_file_or_directory);
+            return {};
+        }
+
+        Sha256 digest;
+        std::vector<char> buffer(1024 * 1024);
+        while (stream)
+        {
+            stream.read(buffer.data(), std::streamsize(buffer.size()));
+            digest.Update(reinterpret_cast<const unsigned char*>(buffer.data()), size_t(stream.gcount()));
+        }
+
+        if (!stream.eof())
+        {
+            err = std::make_error_code(std::errc::io_error);
+            return {};
+        }
+        return digest.Finish();
+    }
+
+    std::string ContentStore::GetSourceHash(const Path& source, const FileInfo& source_info, std::error_code& err)
+    {
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+
+            const auto it = sources.find(source);
+            if (it != sources.end() && it->second.info == source_info)
+            {
+                reused_hashes++;
+                return it->second.hash;
+            }
+        }
+
+        // The size and modification time are those from before the file is read, so that a later change is detected
+        const std::string hash = HashFile(source, err);
+        if (err.value() != 0)
+            return {};
+
+        hashed_files++;
+        hashed_bytes += source_info.size;
+
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        sources.insert_or_assign(source, SourceEntry{ source_info, hash });
+        return hash;
+    }
+
+    std::error_code ContentStore::AddObject(const Path& source, const FileInfo& source_info, const std::string& object_name,
+        const std::string& hash)
+    {
+        const Path object_path = GetObjectPath(object_name);
+
+        const std::optional<FileInfo> object_info = Utilities::GetFileInfo(object_path);
+        if (object_info.has_value())
+        {
+            std::optional<FileInfo> recorded_info;
+            {
+                std::shared_lock<std::shared_mutex> lock(mutex);
+
+                const auto it = objects.find(object_name);
+                if (it != objects.end())
+                    recorded_info = it->second;
+            }
+
+            // Objects added by other processes are verified once, those modified since then (e.g. through a hard link) are replaced
+            std::error_code hash_err;
+            if (recorded_info == object_info ||
+                (!recorded_info.has_value() && HashFile(object_path, hash_err) == hash && hash_err.value() == 0))
+            {
+                reused_objects++;
+
+                std::unique_lock<std::shared_mutex> lock(mutex);
+                objects.insert_or_assign(object_name, object_info.value());
+                return {};
+            }
+        }
+
+        // The object is copied next to its final path, then moved in place, so that it's never seen partially written
+        std::error_code err;
+        std::filesystem::create_directories(std::filesystem::path(object_path).parent_path(), err);
+        if (err.value() != 0)
+            return err;
+
+        const Path temporary_path = Utilities::CreateTemporaryFile(object_path, err);
+        if (temporary_path.empty())
+            return err;
+
+        // The copy must still have the content of the hash, in case the source has changed without its size
+        //  or modification time (or while it was being read), since the object is only verified once
+        err = FileCopier::Copy(source, temporary_path);
+        if (err.value() == 0 && Utilities::GetFileInfo(source) != source_info)
+            err = std::make_error_code(std::errc::interrupted);
+        if (err.value() == 0 && HashFile(temporary_path, err) != hash && err.value() == 0)
+        {
+            // The recorded hash of the source is wrong, it's computed again by the next installation
+            err = std::make_error_code(std::errc::interrupted);
+
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            sources.erase(source);
+        }
+        if (err.value() == 0)
+            std::filesystem::rename(std::filesystem::path(temporary_path), std::filesystem::path(object_path), err);
+
+        const std::optional<FileInfo> added_info = Utilities::GetFileInfo(object_path);
+        if (err.value() != 0 || !added_info.has_value())
+        {
+            std::error_code remove_err;
+            std::filesystem::remove(std::filesystem::path(temporary_path), remove_err);
+            return err.value() != 0 ? err : std::make_error_code(std::errc::no_such_file_or_directory);
+        }
+
+        added_objects++;
+
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        objects.insert_or_assign(object_name, added_info.value());
+        return {};
+    }
+
+    std::error_code ContentStore::PlaceObject(const Path& object_path, const Path& destination)
+    {
+        // Neither reflinks nor hard links can overwrite an existing file, which is removed first
+        std::error_code err;
+        std::filesystem::remove(std::filesystem::path(destination), err);
+        if (err.value() != 0)
+            return err;
+
+        if (FileCopier::Clone(object_path, destination).value() == 0)
+        {
+            reflinked_files++;
+            return {};
+        }
+
+        std::filesystem::create_hard_link(std::filesystem::path(object_path), std::filesystem::path(destination), err);
+        if (err.value() == 0)
+        {
+            hard_linked_files++;
+            return {};
+        }
+
+        // The store is on a different file system (or it doesn't support links at all)
+        copied_files++;
+        return FileCopier::Copy(object_path, destination);
+    }
+
+    Path ContentStore::GetObjectPath(const std::string& object_name) const
+    {
+        // Objects are spread over 256 sub-directories, by the first byte of their hash
+        return Utilities::CombinePath(Utilities::CombinePath(Utilities::CombinePath(store_directory, "objects"),
+            object_name.substr(0, 2)), object_name);
+    }
+}
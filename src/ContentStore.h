@@ -0,0 +1,83 @@
+#pragma once
+
+#include "Types.h"
+#include "Utilities.h"
+
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+
+namespace Hansel
+{
+    /* Local content-addressed store of installed files, which can be shared by any number of workspaces and
+        output directories (e.g. ~/.cache/hansel/cas), so that identical files are stored only once.
+       Each installed file is added to the store under the SHA-256 hash of its content (and its permissions),
+        then placed in the output directory by reflink, by hard link if the file system doesn't support reflinks,
+        or by copy if the store is on a different file system. Files placed by hard link share their data
+        with the store, and must not be modified in place (a modified object is detected and replaced).
+       The hash of each source file is recorded together with its size and modification time in the index of the
+        store, so that it's computed again only when the file changes. Several processes can use the store at the
+        same time: objects are always replaced atomically, and index entries lost by concurrent saves are recomputed.
+       It can be used concurrently by the threads which execute an InstallPlan. */
+    class ContentStore
+    {
+    public:
+
+        // Loads the index of the store in 'store_directory', which is created if it doesn't exist yet
+        explicit ContentStore(const Path& store_directory);
+
+        // Installs a copy of 'source' to the 'destination' file path (overwriting it) through the store
+        std::error_code Install(const Path& source, const Path& destination);
+
+        // Writes the index back to the store directory, replacing the previous one
+        void Save() const;
+
+        // Prints the number of hashed files, added and reused objects, and how they have been placed (verbose only)
+        void PrintStatistics() const;
+
+    private:
+
+        using FileInfo = Utilities::FileInfo;
+
+        struct SourceEntry
+        {
+            FileInfo    info;
+            std::string hash;
+        };
+
+        // Adds the source or object entry described by the fields of an index line, returns false if they are not valid
+        bool ParseIndexEntry(const std::vector<std::string>& fields);
+
+        // Returns the SHA-256 hash of the content of the file (as a hexadecimal string), or an empty string on errors
+        static std::string HashFile(const Path& path, std::error_code& err);
+
+        // Returns the hash of the source file, recorded in the index if the file hasn't changed since then
+        std::string GetSourceHash(const Path& source, const FileInfo& source_info, std::error_code& err);
+
+        // Adds the source file to the store as the given object, unless an intact copy of it is already there
+        std::error_code AddObject(const Path& source, const FileInfo& source_info, const std::string& object_name,
+            const std::string& hash);
+
+        std::error_code PlaceObject(const Path& object_path, const Path& destination);
+
+        Path GetObjectPath(const std::string& object_name) const;
+
+        const Path store_directory;
+        const Path index_path;
+
+        std::unordered_map<Path, SourceEntry> sources;
+        std::unordered_map<std::string, FileInfo> objects;
+        mutable std::shared_mutex mutex;
+
+        std::atomic<uint32_t> hashed_files = 0;
+        std::atomic<uint64_t> hashed_bytes = 0;
+        std::atomic<uint32_t> reused_hashes = 0;
+        std::atomic<uint32_t> added_objects = 0;
+        std::atomic<uint32_t> reused_objects = 0;
+        std::atomic<uint32_t> reflinked_files = 0;
+        std::atomic<uint32_t> hard_linked_files = 0;
+        std::atomic<uint32_t> copied_files = 0;
+    };
+}
@@ -1,4 +1,5 @@
 #include "Dependencies.h"
+#include "ExpansionCache.h"
 #include "Logger.h"
 #include "Utilities.h"
 
@@ -25,6 +26,37 @@ static void Print_Internal(const std::string& prefix, const std::string& type, c
 }
 
 
+std::vector<Hansel::Dependency*> Hansel::Dependency::SelectPlatform(const std::vector<Dependency*>& dependencies, size_t platform_index)
+{
+	std::map<const Dependency*, Dependency*> selected;
+	return SelectPlatformDependencies(dependencies, platform_index, selected);
+}
+
+std::vector<Hansel::Dependency*> Hansel::Dependency::SelectPlatformDependencies(const std::vector<Dependency*>& dependencies,
+	size_t platform_index, std::map<const Dependency*, Dependency*>& selected)
+{
+	std::vector<Hansel::Dependency*> platform_dependencies;
+	for (Dependency* dependency : dependencies)
+	{
+		if ((dependency->platforms & (PlatformMask(1) << platform_index)) == 0)
+			continue;
+
+		// Sub-trees which are shared by multiple dependencies are filtered only once
+		auto it = selected.find(dependency);
+		if (it == selected.end())
+			it = selected.emplace(dependency, dependency->SelectPlatformSubTree(platform_index, selected)).first;
+		platform_dependencies.push_back(it->second);
+	}
+	return platform_dependencies;
+}
+
+Hansel::Dependency* Hansel::Dependency::SelectPlatformSubTree(size_t /*platform_index*/, std::map<const Dependency*, Dependency*>& /*selected*/)
+{
+	// No sub-dependencies
+	return this;
+}
+
+
 std::vector<Hansel::Dependency*> Hansel::RootDependency::GetDirectDependencies() const
 {
 	return dependencies;
@@ -43,44 +75,50 @@ std::vector<Hansel::Dependency*> Hansel::RootDependency::GetAllDependencies() co
 	return all_dependencies;
 }
 
-bool Hansel::RootDependency::Realize(bool debug, bool verbose) const
+bool Hansel::RootDependency::Realize(bool debug, bool verbose, uint32_t thread_count, Settings::LinkMode link_mode, InstallManifest* manifest,
+	ContentStore* store, uint32_t max_processes, CommandStamps* stamps) const
 {
 	std::printf("\nCopying dependencies of %s to '%s'...\n",
 		breadcrumb_name.c_str(), destination.c_str());
 
-	bool result = true;
 	if (dependencies.size() > 0)
 	{
-		for (const Dependency* dependency : dependencies)
-		{
-			// Realize sub-dependencies first
-			if (dependency->GetType() == Dependency::Type::Library ||
-				dependency->GetType() == Dependency::Type::Project)
-			{
-				if (!dependency->Realize(debug, verbose))
-					result = false;
-			}
-		}
+		// Plan the whole installation first, so that independent actions can be executed concurrently
+		InstallPlan plan(debug, verbose, link_mode, manifest, store, max_processes, stamps);
+		Plan(plan);
 
-		if (debug || verbose)
-			std::printf("**** ROOT: %s\n", breadcrumb_name.c_str());
+		return plan.Execute(thread_count);
+	}
+	else
+	{
+		std::printf("\n  NO DEPENDENCIES\n");
+	}
+	return true;
+}
 
-		for (const Dependency* dependency : dependencies)
+void Hansel::RootDependency::Plan(InstallPlan& plan) const
+{
+	for (const Dependency* dependency : dependencies)
+	{
+		// Install sub-dependencies first
+		if (dependency->GetType() == Dependency::Type::Library ||
+			dependency->GetType() == Dependency::Type::Project)
 		{
-			// Realize direct dependencies last
-			if (dependency->GetType() != Dependency::Type::Library &&
-				dependency->GetType() != Dependency::Type::Project)
-			{
-				if (!dependency->Realize(debug, verbose))
-					result = false;
-			}
+			dependency->Plan(plan);
 		}
 	}
-	else
+
+	plan.AddMessage(std::format("**** ROOT: {}\n", breadcrumb_name));
+
+	for (const Dependency* dependency : dependencies)
 	{
-		std::printf("\n  NO DEPENDENCIES\n");
+		// Install direct dependencies last
+		if (dependency->GetType() != Dependency::Type::Library &&
+			dependency->GetType() != Dependency::Type::Project)
+		{
+			dependency->Plan(plan);
+		}
 	}
-	return result;
 }
 
 void Hansel::RootDependency::Print(const std::string& prefix) const
@@ -123,34 +161,34 @@ std::vector<Hansel::Dependency*> Hansel::ProjectDependency::GetAllDependencies()
 	return all_dependencies;
 }
 
-bool Hansel::ProjectDependency::Realize(bool debug, bool verbose) const
+void Hansel::ProjectDependency::Plan(InstallPlan& plan) const
 {
-	bool result = true;
+	// The commands of the subtree run after those of its sub-dependencies, see InstallPlan::BeginScope()
+	plan.BeginScope();
+
 	for (const Dependency* dependency : dependencies)
 	{
-		// Realize sub-dependencies first
+		// Install sub-dependencies first
 		if (dependency->GetType() == Dependency::Type::Library ||
 			dependency->GetType() == Dependency::Type::Project)
 		{
-			if (!dependency->Realize(debug, verbose))
-				result = false;
+			dependency->Plan(plan);
 		}
 	}
 
-	if (debug || verbose)
-		std::printf("**** PROJECT: %s\n", name.c_str());
+	plan.AddMessage(std::format("**** PROJECT: {}\n", name));
 
 	for (const Dependency* dependency : dependencies)
 	{
-		// Realize direct dependencies last
+		// Install direct dependencies last
 		if (dependency->GetType() != Dependency::Type::Library &&
 			dependency->GetType() != Dependency::Type::Project)
 		{
-			if (!dependency->Realize(debug, verbose))
-				result = false;
+			dependency->Plan(plan);
 		}
 	}
-	return result;
+
+	plan.EndScope();
 }
 
 void Hansel::ProjectDependency::Print(const std::string& prefix) const
@@ -158,6 +196,15 @@ void Hansel::ProjectDependency::Print(const std::string& prefix) const
 	Print_Internal(prefix, "PROJECT", name, &dependencies);
 }
 
+Hansel::Dependency* Hansel::ProjectDependency::SelectPlatformSubTree(size_t platform_index, std::map<const Dependency*, Dependency*>& selected)
+{
+	const std::vector<Hansel::Dependency*> platform_dependencies = SelectPlatformDependencies(dependencies, platform_index, selected);
+	if (platform_dependencies == dependencies)
+		return this;
+
+	return new ProjectDependency(parent_breadcrumb_path, name, path, destination, platform_dependencies);
+}
+
 
 std::vector<Hansel::Dependency*> Hansel::LibraryDependency::GetDirectDependencies() const
 {
@@ -177,34 +224,34 @@ std::vector<Hansel::Dependency*> Hansel::LibraryDependency::GetAllDependencies()
 	return all_dependencies;
 }
 
-bool Hansel::LibraryDependency::Realize(bool debug, bool verbose) const
+void Hansel::LibraryDependency::Plan(InstallPlan& plan) const
 {
-	bool result = true;
+	// Commands of independent libraries can run at the same time, see InstallPlan::BeginScope()
+	plan.BeginScope();
+
 	for (const Dependency* dependency : dependencies)
 	{
-		// Realize sub-dependencies first
+		// Install sub-dependencies first
 		if (dependency->GetType() == Dependency::Type::Library ||
 			dependency->GetType() == Dependency::Type::Project)
 		{
-			if (!dependency->Realize(debug, verbose))
-				result = false;
+			dependency->Plan(plan);
 		}
 	}
 
-	if (debug || verbose)
-		std::printf("**** LIBRARY: %s %s\n", name.c_str(), version.ToString().c_str());
+	plan.AddMessage(std::format("**** LIBRARY: {} {}\n", name, version.ToString()));
 
 	for (const Dependency* dependency : dependencies)
 	{
-		// Realize direct dependencies last
+		// Install direct dependencies last
 		if (dependency->GetType() != Dependency::Type::Library &&
 			dependency->GetType() != Dependency::Type::Project)
 		{
-			if (!dependency->Realize(debug, verbose))
-				result = false;
+			dependency->Plan(plan);
 		}
 	}
-	return result;
+
+	plan.EndScope();
 }
 
 void Hansel::LibraryDependency::Print(const std::string& prefix) const
@@ -213,6 +260,15 @@ void Hansel::LibraryDependency::Print(const std::string& prefix) const
 	Print_Internal(prefix, "LIBRARY", name_version_str, &dependencies);
 }
 
+Hansel::Dependency* Hansel::LibraryDependency::SelectPlatformSubTree(size_t platform_index, std::map<const Dependency*, Dependency*>& selected)
+{
+	const std::vector<Hansel::Dependency*> platform_dependencies = SelectPlatformDependencies(dependencies, platform_index, selected);
+	if (platform_dependencies == dependencies)
+		return this;
+
+	return new LibraryDependency(parent_breadcrumb_path, name, version, path, destination, platform_dependencies);
+}
+
 
 std::vector<Hansel::Dependency*> Hansel::FileDependency::GetDirectDependencies() const
 {
@@ -226,24 +282,11 @@ std::vector<Hansel::Dependency*> Hansel::FileDependency::GetAllDependencies() co
 	return {};
 }
 
-bool Hansel::FileDependency::Realize(bool debug, bool verbose) const
+void Hansel::FileDependency::Plan(InstallPlan& plan) const
 {
-	if (debug || verbose)
-	{
-		const Path file_destination = Utilities::GetDestinationPath(destination, path);
-		std::printf("Copy file '%s' ==> '%s'\n", path.c_str(), file_destination.c_str());
-
-		if (debug)	// in Debug mode, return without copying the file
-			return true;
-	}
-
-	const std::error_code err = Utilities::CopySingleFile(path, destination);
-	if (err.value() != 0)
-	{
-		Logger::Error(err.message());
-		return false;
-	}
-	return true;
+	const Path file_destination = Utilities::GetDestinationPath(destination, path);
+	plan.AddMessage(std::format("Copy file '{}' ==> '{}'\n", path, file_destination));
+	plan.AddFileCopy(path, file_destination);
 }
 
 void Hansel::FileDependency::Print(const std::string& prefix) const
@@ -264,28 +307,27 @@ std::vector<Hansel::Dependency*> Hansel::FilesDependency::GetAllDependencies() c
 	return {};
 }
 
-bool Hansel::FilesDependency::Realize(bool debug, bool verbose) const
+void Hansel::FilesDependency::Plan(InstallPlan& plan) const
 {
-	if (debug || verbose)
+	// The files generated by the commands which run before can only be listed once they have completed
+	if (plan.FollowsCommands())
 	{
-		const std::vector<Path> files = Utilities::GlobFiles(path);
-		for (const auto file_path : files)
-		{
-			const Path file_destination = Utilities::GetDestinationPath(destination, file_path);
-			std::printf("Copy file '%s' ==> '%s'\n", file_path.c_str(), file_destination.c_str());
-		}
-
-		if (debug)	// in Debug mode, return without copying the files
-			return true;
+		plan.AddMessage(std::format("Copy files '{}' ==> '{}'\n", path, destination));
+		plan.AddFilesCopy(pattern, destination);
+		return;
 	}
 
-	const std::error_code err = Utilities::CopyMultipleFiles(path, destination);
-	if (err.value() != 0)
+	const ExpansionCache::FileList files = ExpansionCache::ExpandPattern(pattern);
+
+	// The destination is created even if no file matches with the pattern
+	plan.AddDirectoryCreation(destination);
+
+	for (const auto& file_path : *files)
 	{
-		Logger::Error(err.message());
-		return false;
+		const Path file_destination = Utilities::GetDestinationPath(destination, file_path, pattern.GetBaseDirectory());
+		plan.AddMessage(std::format("Copy file '{}' ==> '{}'\n", file_path, file_destination));
+		plan.AddFileCopy(file_path, file_destination);
 	}
-	return true;
 }
 
 void Hansel::FilesDependency::Print(const std::string& prefix) const
@@ -306,23 +348,10 @@ std::vector<Hansel::Dependency*> Hansel::DirectoryDependency::GetAllDependencies
 	return {};
 }
 
-bool Hansel::DirectoryDependency::Realize(bool debug, bool verbose) const
+void Hansel::DirectoryDependency::Plan(InstallPlan& plan) const
 {
-	if (debug || verbose)
-	{
-		std::printf("Copy directory '%s' ==> '%s'\n", path.c_str(), destination.c_str());
-
-		if (debug)	// in Debug mode, return without copying the directory
-			return true;
-	}
-
-	const std::error_code err = Utilities::CopyDirectory(path, destination);
-	if (err.value() != 0)
-	{
-		Logger::Error(err.message());
-		return false;
-	}
-	return true;
+	plan.AddMessage(std::format("Copy directory '{}' ==> '{}'\n", path, destination));
+	plan.AddDirectoryCopy(path, destination);
 }
 
 void Hansel::DirectoryDependency::Print(const std::string& prefix) const
@@ -343,26 +372,9 @@ std::vector<Hansel::Dependency*> Hansel::CommandDependency::GetAllDependencies()
 	return {};
 }
 
-bool Hansel::CommandDependency::Realize(bool debug, bool verbose) const
+void Hansel::CommandDependency::Plan(InstallPlan& plan) const
 {
-	// Check the system command processor availability
-	if (!std::system(nullptr))
-		return false;
-
-	if (debug || verbose)
-	{
-		std::printf("Execute command '%s'\n", code.c_str());
-
-		if (debug)	// in Debug mode, return without executing the command
-			return true;
-	}
-
-	// An explicit flush of std::cout is necessary before a call to std::system,
-	//  if the spawned process performs any screen I/O. 
-	std::cout.flush();
-
-	std::system(code.c_str());
-	return true;
+	plan.AddCommand(std::format("Execute command '{}'\n", code), code, inputs, outputs);
 }
 
 void Hansel::CommandDependency::Print(const std::string& prefix) const
@@ -383,26 +395,11 @@ std::vector<Hansel::Dependency*> Hansel::ScriptDependency::GetAllDependencies()
 	return {};
 }
 
-bool Hansel::ScriptDependency::Realize(bool debug, bool verbose) const
+void Hansel::ScriptDependency::Plan(InstallPlan& plan) const
 {
-	// Check the system command processor availability
-	if (!std::system(nullptr))
-		return false;
-
-	if (debug || verbose)
-	{
-		std::printf("Execute script '%s'", path.c_str());
-		if (!arguments.empty())
-			std::printf(" with args: '%s'\n", arguments.c_str());
-		else std::printf("\n");
-
-		if (debug)	// in Debug mode, return without executing the command
-			return true;
-	}
-
-	// An explicit flush of std::cout is necessary before a call to std::system,
-	//  if the spawned process performs any screen I/O. 
-	std::cout.flush();
+	const String message = arguments.empty() ?
+		std::format("Execute script '{}'\n", path) :
+		std::format("Execute script '{}' with args: '{}'\n", path, arguments);
 
 	// Build the command line string for executing the script
 	std::stringstream script_command_line;
@@ -411,9 +408,16 @@ bool Hansel::ScriptDependency::Realize(bool debug, bool verbose) const
 	script_command_line << '"' << path << '"';
 	if (!arguments.empty())
 		script_command_line << ' ' << arguments;
-	
-	std::system(script_command_line.str().c_str());
-	return true;
+
+	// A script which declares its inputs or outputs is executed again when it changes, like its other inputs
+	std::vector<Path> script_inputs;
+	if (!inputs.empty() || !outputs.empty())
+	{
+		script_inputs.push_back(path);
+		script_inputs.insert(script_inputs.end(), inputs.begin(), inputs.end());
+	}
+
+	plan.AddCommand(message, script_command_line.str(), script_inputs, outputs);
 }
 
 void Hansel::ScriptDependency::Print(const std::string& prefix) const
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Types.h"
+#include "InstallPlan.h"
+#include "PathPattern.h"
 
 
 namespace Hansel
@@ -27,17 +29,31 @@ namespace Hansel
         virtual std::vector<Dependency*> GetDirectDependencies() const = 0;
         virtual std::vector<Dependency*> GetAllDependencies() const = 0;
 
-        virtual bool Realize(bool debug = false, bool verbose = false) const = 0;
+        // Adds the actions which install the dependency (after those of its sub-dependencies) to the plan
+        virtual void Plan(InstallPlan& plan) const = 0;
         virtual void Print(const std::string& prefix) const = 0;
 
+        // Target platforms for which the dependency is enabled (all of them by default)
+        PlatformMask GetPlatforms() const { return platforms; }
+        void SetPlatforms(PlatformMask mask) { platforms = mask; }
+
+        /* Returns the dependencies which are enabled for the target platform at 'platform_index', with their
+            sub-trees filtered the same way (sub-trees which don't need any filtering are shared, not copied). */
+        static std::vector<Dependency*> SelectPlatform(const std::vector<Dependency*>& dependencies, size_t platform_index);
+
     protected:
 
         Dependency(const Path& parent_breadcrumb, Type type)
             : parent_breadcrumb_path(parent_breadcrumb), type(type)
         {};
 
+        static std::vector<Dependency*> SelectPlatformDependencies(const std::vector<Dependency*>& dependencies,
+            size_t platform_index, std::map<const Dependency*, Dependency*>& selected);
+        virtual Dependency* SelectPlatformSubTree(size_t platform_index, std::map<const Dependency*, Dependency*>& selected);
+
         Type type;
         Path parent_breadcrumb_path;
+        PlatformMask platforms = ~PlatformMask(0);
     };
 
 
@@ -63,7 +79,17 @@ namespace Hansel
         std::vector<Dependency*> GetDirectDependencies() const override;
         std::vector<Dependency*> GetAllDependencies() const override;
 
-        bool Realize(bool debug = false, bool verbose = false) const override;
+        /* Installs all the dependencies of the tree (in Debug mode, only prints the actions which would be performed).
+           The actions are planned first, then executed with the given number of threads.
+           If a manifest is provided, files which are up-to-date are skipped and the copies are recorded in it.
+           If a content store is provided, files are copied through it (see ContentStore).
+           Up to 'max_processes' commands and scripts of independent subtrees can run at the same time.
+           If command stamps are provided, commands whose declared inputs and outputs are unchanged are skipped. */
+        bool Realize(bool debug = false, bool verbose = false, uint32_t thread_count = 1,
+            Settings::LinkMode link_mode = Settings::LinkMode::Copy, InstallManifest* manifest = nullptr,
+            ContentStore* store = nullptr, uint32_t max_processes = 1, CommandStamps* stamps = nullptr) const;
+
+        void Plan(InstallPlan& plan) const override;
         void Print(const std::string& prefix) const override;
     };
 
@@ -91,8 +117,12 @@ namespace Hansel
         std::vector<Dependency*> GetDirectDependencies() const override;
         std::vector<Dependency*> GetAllDependencies() const override;
 
-        bool Realize(bool debug = false, bool verbose = false) const override;
+        void Plan(InstallPlan& plan) const override;
         void Print(const std::string& prefix) const override;
+
+    protected:
+
+        Dependency* SelectPlatformSubTree(size_t platform_index, std::map<const Dependency*, Dependency*>& selected) override;
     };
 
 
@@ -120,8 +150,12 @@ namespace Hansel
         std::vector<Dependency*> GetDirectDependencies() const override;
         std::vector<Dependency*> GetAllDependencies() const override;
 
-        bool Realize(bool debug = false, bool verbose = false) const override;
+        void Plan(InstallPlan& plan) const override;
         void Print(const std::string& prefix) const override;
+
+    protected:
+
+        Dependency* SelectPlatformSubTree(size_t platform_index, std::map<const Dependency*, Dependency*>& selected) override;
     };
 
 
@@ -144,7 +178,7 @@ namespace Hansel
         std::vector<Dependency*> GetDirectDependencies() const override;
         std::vector<Dependency*> GetAllDependencies() const override;
 
-        bool Realize(bool debug = false, bool verbose = false) const override;
+        void Plan(InstallPlan& plan) const override;
         void Print(const std::string& prefix) const override;
     };
 
@@ -158,17 +192,21 @@ namespace Hansel
         Path  path;
         Path  destination;
 
+        // The pattern is compiled once, then reused every time the files are listed or copied
+        PathPattern pattern;
+
     public:
 
         FilesDependency(const Path& parent_breadcrumb, const Path& path, const Path& destination)
             : Dependency(parent_breadcrumb, Type::Files)
             , path(path), destination(destination)
+            , pattern(path)
         {};
 
         std::vector<Dependency*> GetDirectDependencies() const override;
         std::vector<Dependency*> GetAllDependencies() const override;
 
-        bool Realize(bool debug = false, bool verbose = false) const override;
+        void Plan(InstallPlan& plan) const override;
         void Print(const std::string& prefix) const override;
     };
 
@@ -192,7 +230,7 @@ namespace Hansel
         std::vector<Dependency*> GetDirectDependencies() const override;
         std::vector<Dependency*> GetAllDependencies() const override;
 
-        bool Realize(bool debug = false, bool verbose = false) const override;
+        void Plan(InstallPlan& plan) const override;
         void Print(const std::string& prefix) const override;
     };
 
@@ -205,17 +243,22 @@ namespace Hansel
 
         String  code;
 
+        // Declared files or directories read and written by the command, if any (see CommandStamps)
+        std::vector<Path> inputs;
+        std::vector<Path> outputs;
+
     public:
 
-        CommandDependency(const Path& parent_breadcrumb, const String& code)
+        CommandDependency(const Path& parent_breadcrumb, const String& code,
+            const std::vector<Path>& inputs = {}, const std::vector<Path>& outputs = {})
             : Dependency(parent_breadcrumb, Type::Command)
-            , code(code)
+            , code(code), inputs(inputs), outputs(outputs)
         {};
 
         std::vector<Dependency*> GetDirectDependencies() const override;
         std::vector<Dependency*> GetAllDependencies() const override;
 
-        bool Realize(bool debug = false, bool verbose = false) const override;
+        void Plan(InstallPlan& plan) const override;
         void Print(const std::string& prefix) const override;
     };
 
@@ -231,18 +274,22 @@ namespace Hansel
         Path    path;
         String  arguments;
 
+        // Declared files or directories read and written by the script, if any (the script itself is always an input)
+        std::vector<Path> inputs;
+        std::vector<Path> outputs;
+
     public:
 
         ScriptDependency(const Path& parent_breadcrumb, const Path& interpreter, const String& name,
-            const Path& path, const String& arguments)
+            const Path& path, const String& arguments, const std::vector<Path>& inputs = {}, const std::vector<Path>& outputs = {})
             : Dependency(parent_breadcrumb, Type::Script)
-            , interpreter(interpreter), name(name), path(path), arguments(arguments)
+            , interpreter(interpreter), name(name), path(path), arguments(arguments), inputs(inputs), outputs(outputs)
         {};
 
         std::vector<Dependency*> GetDirectDependencies() const override;
         std::vector<Dependency*> GetAllDependencies() const override;
 
-        bool Realize(bool debug = false, bool verbose = false) const override;
+        void Plan(InstallPlan& plan) const override;
         void Print(const std::string& prefix) const override;
     };
 }
@@ -1,5 +1,7 @@
 #include "DependencyChecker.h"
 
+#include "ExpansionCache.h"
+#include "InstallManifest.h"
 #include "Logger.h"
 #include "Types.h"
 #include "Utilities.h"
@@ -20,6 +22,9 @@ bool Hansel::DependencyChecker::Check(const Hansel::RootDependency* root, const
 		std::map<Path, FileDependencyEntry, StringIgnoreCaseLess> files;
 		bool filesOk = CheckFileOverwrites(settings.target, root->dependencies, files);
 
+		if (Logger::IsVerbose())
+			CheckInstalledFiles(files, settings);
+
 		std::printf("...done! %s.\n",
 			(librariesOk && filesOk) ? "No issues detected" : "Some issues detected, read the logs for more details");
 
@@ -130,7 +135,7 @@ bool Hansel::DependencyChecker::CheckFileOverwrites(const Hansel::String& depend
 			if (files_copied.contains(file_destination))
 			{
 				FileDependencyEntry other = files_copied.at(file_destination);
-				if (file->path != other.file_path)
+				if (!IsSameFile(file->path, other.file_path))
 				{
 					result = false;
 
@@ -148,15 +153,15 @@ bool Hansel::DependencyChecker::CheckFileOverwrites(const Hansel::String& depend
 		{
 			const auto* files = dynamic_cast<const Hansel::FilesDependency*>(dependency);
 
-			const std::vector<Hansel::Path> glob_files = Utilities::GlobFiles(files->path);
-			for (const auto& file_path : glob_files)
+			const Hansel::ExpansionCache::FileList glob_files = Hansel::ExpansionCache::ExpandPattern(files->pattern);
+			for (const auto& file_path : *glob_files)
 			{
-				const Hansel::Path file_destination = Utilities::GetDestinationPath(files->destination, file_path);
+				const Hansel::Path file_destination = Utilities::GetDestinationPath(files->destination, file_path, files->pattern.GetBaseDirectory());
 
 				if (files_copied.contains(file_destination))
 				{
 					FileDependencyEntry other = files_copied.at(file_destination);
-					if (file_path != other.file_path)
+					if (!IsSameFile(file_path, other.file_path))
 					{
 						result = false;
 
@@ -175,8 +180,8 @@ bool Hansel::DependencyChecker::CheckFileOverwrites(const Hansel::String& depend
 		{
 			const auto* directory = dynamic_cast<const Hansel::DirectoryDependency*>(dependency);
 
-			const std::vector<Hansel::Path> directory_files = Utilities::GetAllFilesInDirectory(directory->path);
-			for (const auto& file_path : directory_files)
+			const Hansel::ExpansionCache::FileList directory_files = Hansel::ExpansionCache::ListDirectory(directory->path);
+			for (const auto& file_path : *directory_files)
 			{
 				const Hansel::Path file_destination = Utilities::GetDestinationPath(
 					directory->destination, file_path, directory->path);
@@ -184,7 +189,7 @@ bool Hansel::DependencyChecker::CheckFileOverwrites(const Hansel::String& depend
 				if (files_copied.contains(file_destination))
 				{
 					FileDependencyEntry other = files_copied.at(file_destination);
-					if (file_path != other.file_path)
+					if (!IsSameFile(file_path, other.file_path))
 					{
 						result = false;
 
@@ -231,3 +236,53 @@ bool Hansel::DependencyChecker::CheckFileOverwrites(const Hansel::String& depend
 
 	return result;
 }
+
+
+void Hansel::DependencyChecker::CheckInstalledFiles(const std::map<Hansel::Path, FileDependencyEntry, StringIgnoreCaseLess>& files,
+	const Settings& settings)
+{
+	// A link to the expected source is always up-to-date, a copy only if the manifest shows that it hasn't changed
+	const InstallManifest manifest(settings.output, false);
+
+	uint32_t up_to_date_files = 0;
+	uint32_t linked_files = 0;
+	uint32_t out_of_date_files = 0;
+	uint32_t missing_files = 0;
+	for (const auto& [file_destination, entry] : files)
+	{
+		std::error_code err;
+		if (!std::filesystem::exists(std::filesystem::symlink_status(std::filesystem::path(file_destination), err)))
+		{
+			Logger::InfoVerbose("'{}' is not installed", file_destination);
+			missing_files++;
+		}
+		else if (IsSameFile(file_destination, entry.file_path))
+		{
+			up_to_date_files++;
+			linked_files++;
+		}
+		else if (manifest.IsUpToDate(entry.file_path, file_destination, settings.link_mode))
+		{
+			up_to_date_files++;
+		}
+		else
+		{
+			Logger::InfoVerbose("'{}' is out-of-date", file_destination);
+			out_of_date_files++;
+		}
+	}
+
+	Logger::InfoVerbose("Installed files: {} up-to-date ({} links to their sources), {} out-of-date, {} missing",
+		up_to_date_files, linked_files, out_of_date_files, missing_files);
+}
+
+bool Hansel::DependencyChecker::IsSameFile(const Hansel::Path& path, const Hansel::Path& other_path)
+{
+	if (path == other_path)
+		return true;
+
+	// Different paths can still lead to the same file, e.g. if one of them is a link to the other
+	std::error_code err;
+	const bool equivalent = std::filesystem::equivalent(std::filesystem::path(path), std::filesystem::path(other_path), err);
+	return err.value() == 0 && equivalent;
+}
@@ -60,5 +60,12 @@ namespace Hansel
 		static bool CheckFileOverwrites(const Hansel::String& depender,
 			const std::vector<Hansel::Dependency*>& dependencies,
 			std::map<Hansel::Path, FileDependencyEntry, StringIgnoreCaseLess>& files);
+
+		// Reports which of the files are up-to-date in the output directory, and which are out-of-date or missing (verbose only)
+		static void CheckInstalledFiles(const std::map<Hansel::Path, FileDependencyEntry, StringIgnoreCaseLess>& files,
+			const Settings& settings);
+
+		// Returns true if both paths refer to the same file, even through links
+		static bool IsSameFile(const Hansel::Path& path, const Hansel::Path& other_path);
 	};
 }
\ No newline at end of file
@@ -0,0 +1,133 @@
+#include "DirectoryIndex.h"
+#include "FileSystemCache.h"
+#include "Logger.h"
+#include "Utilities.h"
+
+
+namespace Hansel
+{
+    bool DirectoryIndex::Exists(const Path& root, const Path& relative_path)
+    {
+        const Path combined_path = Utilities::CombinePath(root, relative_path);
+
+        s_Lookups++;
+        {
+            std::shared_lock<std::shared_mutex> lock(s_Mutex);
+            if (s_MissingPaths.contains(combined_path))
+            {
+                s_NegativeHits++;
+                return false;
+            }
+        }
+
+        // Split the relative path in the same way as CombinePath() does
+        Path trimmed_relative_path = Utilities::TrimString(relative_path);
+        while (trimmed_relative_path.starts_with('/') || trimmed_relative_path.starts_with('\\'))
+            trimmed_relative_path.erase(trimmed_relative_path.begin());
+        const std::filesystem::path normal_relative_path = std::filesystem::path(trimmed_relative_path).lexically_normal();
+
+        Path directory = Utilities::TrimString(root);
+        while (directory.ends_with('/') || directory.ends_with('\\'))
+            directory.pop_back();
+        directory = std::filesystem::path(directory).lexically_normal().string();
+
+        bool exists = false;
+        if (directory.empty() || normal_relative_path.empty() || normal_relative_path.has_root_path() ||
+            *normal_relative_path.begin() == "..")
+        {
+            // Paths which can't be resolved inside the root directory are checked directly
+            exists = FileSystemCache::Exists(combined_path);
+        }
+        else
+        {
+            // Walk the path one component at a time, using the index of each directory along the way
+            std::filesystem::path current_path(directory);
+            for (auto component_it = normal_relative_path.begin(); component_it != normal_relative_path.end(); component_it++)
+            {
+                const String component = component_it->string();
+                if (component.empty())
+                    continue;   // trailing directory separator
+
+                const std::shared_ptr<const Index> index = GetIndex(current_path.string());
+                if (!index)
+                {
+                    exists = false;
+                    break;
+                }
+
+                const auto entry_it = index->find(GetIndexName(component));
+                if (entry_it == index->end())
+                {
+                    exists = false;
+                    break;
+                }
+
+                exists = entry_it->second.exists;
+                if (std::next(component_it) != normal_relative_path.end() && !entry_it->second.is_directory)
+                {
+                    exists = false;
+                    break;
+                }
+
+                current_path /= component;
+            }
+        }
+
+        if (!exists)
+        {
+            std::unique_lock<std::shared_mutex> lock(s_Mutex);
+            s_MissingPaths.insert(combined_path);
+        }
+        return exists;
+    }
+
+    void DirectoryIndex::PrintStatistics()
+    {
+        Logger::InfoVerbose("Lookup roots index: {} directories indexed, {} lookups ({} hit the negative lookup set)",
+            s_IndexedDirectories.load(), s_Lookups.load(), s_NegativeHits.load());
+    }
+
+
+    std::shared_ptr<const DirectoryIndex::Index> DirectoryIndex::GetIndex(const Path& directory)
+    {
+        {
+            std::shared_lock<std::shared_mutex> lock(s_Mutex);
+
+            const auto it = s_Indexes.find(directory);
+            if (it != s_Indexes.end())
+                return it->second;
+        }
+
+        std::shared_ptr<Index> index;
+
+        std::error_code err;
+        std::filesystem::directory_iterator directory_it(directory, err);
+        if (err.value() == 0)
+        {
+            s_IndexedDirectories++;
+            index = std::make_shared<Index>();
+
+            // The type of the entries is usually known from the listing itself, only symbolic links need to be followed
+            for (; directory_it != std::filesystem::directory_iterator(); directory_it.increment(err))
+            {
+                std::error_code entry_err;
+                const bool exists = directory_it->exists(entry_err);
+                const bool is_directory = directory_it->is_directory(entry_err);
+
+                index->emplace(GetIndexName(directory_it->path().filename().string()), Entry{ exists, is_directory });
+            }
+        }
+
+        std::unique_lock<std::shared_mutex> lock(s_Mutex);
+        return s_Indexes.try_emplace(directory, std::move(index)).first->second;
+    }
+
+    String DirectoryIndex::GetIndexName(const String& name)
+    {
+#ifdef _WIN32
+        return Utilities::LowerString(name);
+#else
+        return name;
+#endif
+    }
+}
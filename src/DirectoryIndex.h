@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Types.h"
+
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+
+namespace Hansel
+{
+    /* Process-wide index of the contents of the lookup roots (e.g. library name -> versions -> directory).
+       Each directory is listed once, on first use, and then lookups are resolved from memory; paths which are
+        known to be missing are kept in a negative lookup set. Names are case-insensitive on Windows only.
+       As for FileSystemCache, the indexed directories are assumed not to change during the execution. */
+    class DirectoryIndex
+    {
+    public:
+
+        /* Returns true if 'relative_path' exists in the 'root' directory, i.e. the same result as checking
+            the existence of Utilities::CombinePath(root, relative_path) on the filesystem. */
+        static bool Exists(const Path& root, const Path& relative_path);
+
+        // Prints the number of indexed directories and lookups (verbose only)
+        static void PrintStatistics();
+
+    private:
+
+        struct Entry
+        {
+            bool exists;
+            bool is_directory;
+        };
+
+        using Index = std::unordered_map<String, Entry>;
+
+        // Returns the index of 'directory', listing its contents the first time (nullptr if it's not a directory)
+        static std::shared_ptr<const Index> GetIndex(const Path& directory);
+
+        static String GetIndexName(const String& name);
+
+        inline static std::unordered_map<Path, std::shared_ptr<const Index>> s_Indexes;
+        inline static std::unordered_set<Path> s_MissingPaths;
+        inline static std::shared_mutex s_Mutex;
+
+        inline static std::atomic<uint32_t> s_IndexedDirectories = 0;
+        inline static std::atomic<uint32_t> s_Lookups = 0;
+        inline static std::atomic<uint32_t> s_NegativeHits = 0;
+    };
+}
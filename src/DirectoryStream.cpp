@@ -0,0 +1,27 @@
+#include "DirectoryStream.h"
+
+
+namespace Hansel
+{
+    DirectoryStream::DirectoryStream(const Path& directory)
+        : directory_it(directory, std::filesystem::directory_options::follow_directory_symlink, error)
+    {
+    }
+
+    std::optional<DirectoryStream::Entry> DirectoryStream::Next()
+    {
+        // The iterator stays on the last returned entry until the next call
+        if (started && error.value() == 0 && directory_it != std::filesystem::recursive_directory_iterator())
+            directory_it.increment(error);
+        started = true;
+
+        for (; error.value() == 0 && directory_it != std::filesystem::recursive_directory_iterator(); directory_it.increment(error))
+        {
+            std::error_code entry_err;
+            const bool is_directory = directory_it->is_directory(entry_err);
+            if (is_directory || directory_it->is_regular_file(entry_err))
+                return Entry{ directory_it->path().string(), is_directory };
+        }
+        return {};
+    }
+}
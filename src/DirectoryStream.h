@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Types.h"
+
+#include <optional>
+
+
+namespace Hansel
+{
+    /* Recursive enumeration of the contents of a directory, which reads the tree as the entries are requested,
+        so that they can be consumed (e.g. copied) while the rest of the tree hasn't been listed yet and memory
+        usage doesn't depend on the size of the tree. It runs on the thread of the consumer.
+       Entries are produced in the same order as a depth-first walk of the tree, with each directory listed
+        before its contents; symbolic links to directories are followed. */
+    class DirectoryStream
+    {
+    public:
+
+        struct Entry
+        {
+            Path path;
+            bool is_directory;
+        };
+
+        explicit DirectoryStream(const Path& directory);
+
+        DirectoryStream(const DirectoryStream&) = delete;
+        DirectoryStream& operator=(const DirectoryStream&) = delete;
+
+        /* Returns the next entry.
+           Returns an empty optional once all the entries have been consumed or enumeration failed (see GetError()). */
+        std::optional<Entry> Next();
+
+        // Returns the error which stopped the enumeration, if any
+        std::error_code GetError() const { return error; }
+
+    private:
+
+        std::error_code error;      // declared first, the iterator reports its construction errors to it
+        std::filesystem::recursive_directory_iterator directory_it;
+        bool started = false;
+    };
+}
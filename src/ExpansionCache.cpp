@@ -0,0 +1,47 @@
+#include "ExpansionCache.h"
+#include "Logger.h"
+#include "Utilities.h"
+
+
+namespace Hansel
+{
+    ExpansionCache::FileList ExpansionCache::ExpandPattern(const PathPattern& pattern)
+    {
+        return GetFileList(s_Patterns, pattern.GetPattern(), [&pattern]() { return pattern.Expand(); });
+    }
+
+    ExpansionCache::FileList ExpansionCache::ListDirectory(const Path& directory)
+    {
+        return GetFileList(s_Directories, directory, [&directory]() { return Utilities::GetAllFilesInDirectory(directory); });
+    }
+
+    void ExpansionCache::PrintStatistics()
+    {
+        Logger::InfoVerbose("File expansion cache: {} expansions reused, {} performed ({} files enumerated)",
+            s_Hits.load(), s_Misses.load(), s_EnumeratedFiles.load());
+    }
+
+
+    template<typename Expand>
+    ExpansionCache::FileList ExpansionCache::GetFileList(std::unordered_map<Path, FileList>& cache, const Path& key, Expand&& expand)
+    {
+        {
+            std::shared_lock<std::shared_mutex> lock(s_Mutex);
+
+            const auto it = cache.find(key);
+            if (it != cache.end())
+            {
+                s_Hits++;
+                return it->second;
+            }
+        }
+
+        // Errors (e.g. a missing directory) are not cached, they are reported again by the next expansion
+        s_Misses++;
+        FileList files = std::make_shared<const std::vector<Path>>(expand());
+        s_EnumeratedFiles += files->size();
+
+        std::unique_lock<std::shared_mutex> lock(s_Mutex);
+        return cache.try_emplace(key, std::move(files)).first->second;
+    }
+}
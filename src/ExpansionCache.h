@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Types.h"
+#include "PathPattern.h"
+
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+
+namespace Hansel
+{
+    /* Process-wide cache of the files matched by <Files> patterns and contained in <Directory> dependencies,
+        so that every phase of the execution (and every platform, or breadcrumb which includes the same library)
+        reads the same expansion instead of walking the directory trees again.
+       As for FileSystemCache, the source trees are assumed not to change during the execution. */
+    class ExpansionCache
+    {
+    public:
+
+        using FileList = std::shared_ptr<const std::vector<Path>>;
+
+        // Returns the files which match with the pattern, see PathPattern::Expand()
+        static FileList ExpandPattern(const PathPattern& pattern);
+
+        // Returns all the files in the directory and in its sub-directories, see Utilities::GetAllFilesInDirectory()
+        static FileList ListDirectory(const Path& directory);
+
+        // Prints the number of expansions which have been reused and the number of enumerated entries (verbose only)
+        static void PrintStatistics();
+
+    private:
+
+        template<typename Expand>
+        static FileList GetFileList(std::unordered_map<Path, FileList>& cache, const Path& key, Expand&& expand);
+
+        inline static std::unordered_map<Path, FileList> s_Patterns;
+        inline static std::unordered_map<Path, FileList> s_Directories;
+        inline static std::shared_mutex s_Mutex;
+
+        inline static std::atomic<uint32_t> s_Hits = 0;
+        inline static std::atomic<uint32_t> s_Misses = 0;
+        inline static std::atomic<uint64_t> s_EnumeratedFiles = 0;
+    };
+}
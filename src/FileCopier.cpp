@@ -0,0 +1,429 @@
+#include "FileCopier.h"
+#include "IoUringCopier.h"
+#include "Logger.h"
+
+#include <algorithm>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <unistd.h>
+#endif
+
+
+namespace Hansel
+{
+#ifdef __linux__
+    // Size of the buffer used by the read/write loop, and maximum size of a single kernel transfer
+    static constexpr size_t READ_WRITE_BUFFER_SIZE = 1024 * 1024;
+    static constexpr uint64_t MAX_TRANSFER_SIZE = 0x7FFFF000;
+
+    // Closes the file descriptor when it goes out of scope
+    class FileDescriptor
+    {
+    public:
+
+        explicit FileDescriptor(int fd) : fd(fd) {}
+        ~FileDescriptor() { if (fd >= 0) close(fd); }
+
+        FileDescriptor(const FileDescriptor&) = delete;
+        FileDescriptor& operator=(const FileDescriptor&) = delete;
+
+        int Get() const { return fd; }
+
+    private:
+
+        int fd;
+    };
+
+    static std::error_code GetLastError()
+    {
+        return std::error_code(errno, std::system_category());
+    }
+
+    // Errors which are returned when a transfer mechanism is not available for the files involved
+    static bool IsUnsupportedError(int error)
+    {
+        return error == ENOSYS || error == EOPNOTSUPP || error == ENOTTY || error == EXDEV || error == EINVAL ||
+            error == EBADF || error == EPERM;
+    }
+#endif
+
+
+    std::error_code FileCopier::Copy(const Path& source, const Path& destination)
+    {
+#ifdef __linux__
+        return CopyWithKernel(source, destination);
+#else
+        return CopyWithFilesystem(source, destination);
+#endif
+    }
+
+    std::error_code FileCopier::Clone(const Path& source, const Path& destination)
+    {
+#ifdef __linux__
+        const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+        const FileDescriptor source_fd(open(source.c_str(), O_RDONLY | O_CLOEXEC));
+        if (source_fd.Get() < 0)
+            return GetLastError();
+
+        struct stat source_stat;
+        struct stat directory_stat;
+        if (fstat(source_fd.Get(), &source_stat) != 0)
+            return GetLastError();
+        if (stat(std::filesystem::path(destination).parent_path().c_str(), &directory_stat) != 0)
+            return GetLastError();
+
+        // Devices which are known not to support reflinks are not tried again
+        const std::pair<uint64_t, uint64_t> devices(source_stat.st_dev, directory_stat.st_dev);
+        {
+            std::shared_lock<std::shared_mutex> lock(s_Mutex);
+
+            const auto it = s_DeviceMethods.find(devices);
+            if (it != s_DeviceMethods.end() && it->second != Method::Reflink)
+                return std::make_error_code(std::errc::operation_not_supported);
+        }
+
+        const FileDescriptor destination_fd(open(destination.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+            source_stat.st_mode & 07777));
+        if (destination_fd.Get() < 0)
+            return GetLastError();
+
+        if (ioctl(destination_fd.Get(), FICLONE, source_fd.Get()) != 0 ||
+            fchmod(destination_fd.Get(), source_stat.st_mode & 07777) != 0)
+        {
+            const int error = errno;
+            unlink(destination.c_str());
+
+            if (IsUnsupportedError(error))
+            {
+                std::unique_lock<std::shared_mutex> lock(s_Mutex);
+                s_DeviceMethods.try_emplace(devices, Method::CopyFileRange);
+            }
+            return std::error_code(error, std::system_category());
+        }
+
+        {
+            std::unique_lock<std::shared_mutex> lock(s_Mutex);
+            s_DeviceMethods.try_emplace(devices, Method::Reflink);
+        }
+
+        RecordCopy(Method::Reflink, uint64_t(source_stat.st_size), std::chrono::steady_clock::now() - start_time);
+        return {};
+#else
+        return std::make_error_code(std::errc::operation_not_supported);
+#endif
+    }
+
+    std::vector<std::error_code> FileCopier::CopyFiles(const std::vector<std::pair<Path, Path>>& files)
+    {
+        std::vector<std::error_code> errors(files.size());
+        std::vector<bool> copied(files.size(), false);
+
+#ifdef __linux__
+        if (s_QueueDepth > 0 && files.size() > 1 && !s_IsIoUringUnavailable.load())
+        {
+            const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+            IoUringCopier copier(s_QueueDepth, mode_t(s_CreationMask));
+            if (copier.IsValid())
+            {
+                uint64_t copied_bytes = 0;
+                copied = copier.CopyFiles(files, copied_bytes);
+
+                const uint64_t copied_files = uint64_t(std::count(copied.begin(), copied.end(), true));
+                if (copied_files > 0)
+                    RecordCopy(Method::IoUring, copied_bytes, std::chrono::steady_clock::now() - start_time, copied_files);
+            }
+            else if (!s_IsIoUringUnavailable.exchange(true))
+            {
+                Logger::Warn("io_uring is not available, files will be copied one at a time");
+            }
+        }
+#endif
+
+        // Whatever hasn't been copied in a batch (large or special files, and failures) goes through the usual path
+        for (size_t i = 0; i < files.size(); i++)
+        {
+            if (!copied[i])
+                errors[i] = Copy(files[i].first, files[i].second);
+        }
+        return errors;
+    }
+
+    void FileCopier::SetQueueDepth(uint32_t queue_depth)
+    {
+#ifdef __linux__
+        s_QueueDepth = queue_depth;
+
+        // The umask can only be read by replacing it, so it's done once before any copy starts
+        const mode_t mask = umask(0);
+        umask(mask);
+        s_CreationMask = uint32_t(mask);
+#else
+        if (queue_depth > 0)
+            Logger::Warn("io_uring is only available on Linux, files will be copied one at a time");
+#endif
+    }
+
+    void FileCopier::PrintStatistics()
+    {
+        if (!Logger::IsVerbose())
+            return;
+
+#ifdef __linux__
+        {
+            std::shared_lock<std::shared_mutex> lock(s_Mutex);
+            for (const auto& [devices, method] : s_DeviceMethods)
+            {
+                Logger::Info("File copies from device {}:{} to device {}:{} use {}",
+                    major(devices.first), minor(devices.first), major(devices.second), minor(devices.second),
+                    GetMethodName(method));
+            }
+        }
+#endif
+
+        for (size_t i = 0; i < size_t(Method::Count); i++)
+        {
+            const uint64_t files = s_CopiedFiles[i].load();
+            if (files == 0)
+                continue;
+
+            // The time is summed over all the copies, so this is the throughput of a single thread
+            const uint64_t bytes = s_CopiedBytes[i].load();
+            const int64_t nanoseconds = std::max<int64_t>(s_CopyNanoseconds[i].load(), 1);
+            const uint64_t throughput = uint64_t(double(bytes) / (1024 * 1024) * 1e9 / double(nanoseconds));
+
+            Logger::Info("Copied {} files ({} MB) with {}, {} MB/s",
+                files, bytes / (1024 * 1024), GetMethodName(Method(i)), throughput);
+        }
+    }
+
+
+    const char* FileCopier::GetMethodName(Method method)
+    {
+        switch (method)
+        {
+            case Method::Reflink:       return "reflinks (FICLONE)";
+            case Method::CopyFileRange: return "copy_file_range()";
+            case Method::SendFile:      return "sendfile()";
+            case Method::ReadWrite:     return "read()/write()";
+            case Method::IoUring:       return "io_uring";
+            case Method::Standard:      return "std::filesystem::copy_file()";
+            default:                    return "unknown";
+        }
+    }
+
+#ifdef __linux__
+    std::error_code FileCopier::CopyWithKernel(const Path& source, const Path& destination)
+    {
+        const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+        const FileDescriptor source_fd(open(source.c_str(), O_RDONLY | O_CLOEXEC));
+        if (source_fd.Get() < 0)
+            return GetLastError();
+
+        struct stat source_stat;
+        if (fstat(source_fd.Get(), &source_stat) != 0)
+            return GetLastError();
+
+        // Anything other than a copy between regular files is left to the standard library,
+        //  which also refuses to copy a file onto itself
+        struct stat destination_stat;
+        if (!S_ISREG(source_stat.st_mode))
+            return CopyWithFilesystem(source, destination);
+        if (stat(destination.c_str(), &destination_stat) == 0 && (!S_ISREG(destination_stat.st_mode) ||
+            (destination_stat.st_dev == source_stat.st_dev && destination_stat.st_ino == source_stat.st_ino)))
+        {
+            return CopyWithFilesystem(source, destination);
+        }
+
+        const FileDescriptor destination_fd(open(destination.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+            source_stat.st_mode & 07777));
+        if (destination_fd.Get() < 0 || fstat(destination_fd.Get(), &destination_stat) != 0)
+            return GetLastError();
+
+        const std::pair<uint64_t, uint64_t> devices(source_stat.st_dev, destination_stat.st_dev);
+        Method method = Method::Reflink;
+        bool is_known_device_pair = false;
+        {
+            std::shared_lock<std::shared_mutex> lock(s_Mutex);
+
+            const auto it = s_DeviceMethods.find(devices);
+            if (it != s_DeviceMethods.end())
+            {
+                method = it->second;
+                is_known_device_pair = true;
+            }
+        }
+
+        // Each mechanism continues the transfer from where the previous one has stopped,
+        //  those which are not supported from the start are skipped by the following copies
+        const uint64_t size = uint64_t(source_stat.st_size);
+        uint64_t offset = 0;
+        std::error_code err;
+        while (true)
+        {
+            const TransferResult result = Transfer(method, source_fd.Get(), destination_fd.Get(), size, offset, err);
+            if (result == TransferResult::Failed)
+                return err;
+
+            if (result == TransferResult::Completed)
+            {
+                if (!is_known_device_pair)
+                {
+                    std::unique_lock<std::shared_mutex> lock(s_Mutex);
+                    s_DeviceMethods.try_emplace(devices, method);
+                }
+                break;
+            }
+
+            method = Method(size_t(method) + 1);
+            if (offset == 0)
+            {
+                std::unique_lock<std::shared_mutex> lock(s_Mutex);
+                s_DeviceMethods.insert_or_assign(devices, method);
+                is_known_device_pair = true;
+            }
+        }
+
+        // Like std::filesystem::copy_file(), an existing destination gets the permissions of the source
+        if (fchmod(destination_fd.Get(), source_stat.st_mode & 07777) != 0)
+            return GetLastError();
+
+        RecordCopy(method, offset, std::chrono::steady_clock::now() - start_time);
+        return {};
+    }
+
+    FileCopier::TransferResult FileCopier::Transfer(Method method, int source_fd, int destination_fd, uint64_t size,
+        uint64_t& offset, std::error_code& err)
+    {
+        switch (method)
+        {
+            case Method::Reflink:
+            {
+                // Clones the whole file at once, without copying any data
+                if (ioctl(destination_fd, FICLONE, source_fd) != 0)
+                {
+                    if (IsUnsupportedError(errno))
+                        return TransferResult::Unsupported;
+
+                    err = GetLastError();
+                    return TransferResult::Failed;
+                }
+
+                offset = size;
+                return TransferResult::Completed;
+            }
+
+            case Method::CopyFileRange:
+            case Method::SendFile:
+            {
+                // sendfile() writes at the position of the destination, which a previous mechanism may have left
+                //  anywhere since copy_file_range() and pwrite() don't move it
+                if (method == Method::SendFile && lseek(destination_fd, off_t(offset), SEEK_SET) < 0)
+                {
+                    err = GetLastError();
+                    return TransferResult::Failed;
+                }
+
+                // Copies the data inside the kernel, stopping early if the source turns out to be shorter
+                while (offset < size)
+                {
+                    off_t source_offset = off_t(offset);
+                    off_t destination_offset = off_t(offset);
+                    const size_t length = size_t(std::min(size - offset, MAX_TRANSFER_SIZE));
+
+                    const ssize_t copied = (method == Method::CopyFileRange)
+                        ? copy_file_range(source_fd, &source_offset, destination_fd, &destination_offset, length, 0)
+                        : sendfile(destination_fd, source_fd, &source_offset, length);
+                    if (copied < 0)
+                    {
+                        if (errno == EINTR)
+                            continue;
+                        if (IsUnsupportedError(errno))
+                            return TransferResult::Unsupported;
+
+                        err = GetLastError();
+                        return TransferResult::Failed;
+                    }
+                    if (copied == 0)
+                        break;
+
+                    offset += uint64_t(copied);
+                }
+                return TransferResult::Completed;
+            }
+
+            case Method::ReadWrite:
+            {
+                // Copies until the end of the source file, which may differ from the size seen at the start
+                thread_local std::vector<char> buffer(READ_WRITE_BUFFER_SIZE);
+                while (true)
+                {
+                    const ssize_t read_size = pread(source_fd, buffer.data(), buffer.size(), off_t(offset));
+                    if (read_size < 0)
+                    {
+                        if (errno == EINTR)
+                            continue;
+
+                        err = GetLastError();
+                        return TransferResult::Failed;
+                    }
+                    if (read_size == 0)
+                        return TransferResult::Completed;
+
+                    ssize_t written_size = 0;
+                    while (written_size < read_size)
+                    {
+                        const ssize_t written = pwrite(destination_fd, buffer.data() + written_size,
+                            size_t(read_size - written_size), off_t(offset + written_size));
+                        if (written < 0)
+                        {
+                            if (errno == EINTR)
+                                continue;
+
+                            err = GetLastError();
+                            return TransferResult::Failed;
+                        }
+                        written_size += written;
+                    }
+                    offset += uint64_t(read_size);
+                }
+            }
+
+            default:
+                err = std::make_error_code(std::errc::not_supported);
+                return TransferResult::Failed;
+        }
+    }
+#endif
+
+    std::error_code FileCopier::CopyWithFilesystem(const Path& source, const Path& destination)
+    {
+        const std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+        std::error_code err;
+        std::filesystem::copy_file(std::filesystem::path(source), std::filesystem::path(destination),
+            std::filesystem::copy_options::overwrite_existing, err);
+        if (err.value() != 0)
+            return err;
+
+        std::error_code size_err;
+        const uintmax_t size = std::filesystem::file_size(std::filesystem::path(destination), size_err);
+        RecordCopy(Method::Standard, size_err.value() == 0 ? uint64_t(size) : 0, std::chrono::steady_clock::now() - start_time);
+        return {};
+    }
+
+    void FileCopier::RecordCopy(Method method, uint64_t bytes, std::chrono::steady_clock::duration time, uint64_t files)
+    {
+        s_CopiedFiles[size_t(method)] += files;
+        s_CopiedBytes[size_t(method)] += bytes;
+        s_CopyNanoseconds[size_t(method)] += std::chrono::duration_cast<std::chrono::nanoseconds>(time).count();
+    }
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "Types.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+
+
+namespace Hansel
+{
+    /* Copies single files, choosing the cheapest mechanism which is supported by the file systems involved.
+       On Linux the data is transferred inside the kernel whenever possible, trying in order: reflinks
+        (ioctl FICLONE, which share the data blocks on copy-on-write file systems such as btrfs and xfs),
+        copy_file_range(), sendfile() and finally a plain read/write loop with a large buffer.
+        The first mechanism which works for a pair of source and destination file systems is remembered,
+        so that the following copies between them don't try again those which are not supported.
+       Batches of small files can also be copied with io_uring (see IoUringCopier), when a queue depth is set.
+       On the other platforms, files are copied with std::filesystem::copy_file(). */
+    class FileCopier
+    {
+    public:
+
+        // Copies 'source' to the 'destination' file path, overwriting it (the parent directory must exist)
+        static std::error_code Copy(const Path& source, const Path& destination);
+
+        /* Copies each (source, destination) pair of files like Copy(), returning the error of each one.
+           With a queue depth set, the small files are copied together through io_uring, and the others
+            (or all of them, if io_uring is not available) one at a time. */
+        static std::vector<std::error_code> CopyFiles(const std::vector<std::pair<Path, Path>>& files);
+
+        // Sets the number of io_uring requests submitted at once by CopyFiles(), 0 disables io_uring (default)
+        static void SetQueueDepth(uint32_t queue_depth);
+        static uint32_t GetQueueDepth() { return s_QueueDepth; }
+
+        /* Creates 'destination' (which must not exist) as a reflink of 'source', sharing its data blocks.
+           Returns an error if the file systems involved don't support reflinks, or on platforms other than Linux. */
+        static std::error_code Clone(const Path& source, const Path& destination);
+
+        // Prints the mechanism used for each file system, and the number of files, bytes and throughput of each one (verbose only)
+        static void PrintStatistics();
+
+    private:
+
+        enum class Method : uint8_t
+        {
+            Reflink,
+            CopyFileRange,
+            SendFile,
+            ReadWrite,
+            IoUring,
+            Standard,
+            Count
+        };
+
+        enum class TransferResult
+        {
+            Completed,
+            Unsupported,
+            Failed
+        };
+
+        static const char* GetMethodName(Method method);
+
+#ifdef __linux__
+        static std::error_code CopyWithKernel(const Path& source, const Path& destination);
+        static TransferResult Transfer(Method method, int source_fd, int destination_fd, uint64_t size,
+            uint64_t& offset, std::error_code& err);
+#endif
+        static std::error_code CopyWithFilesystem(const Path& source, const Path& destination);
+
+        static void RecordCopy(Method method, uint64_t bytes, std::chrono::steady_clock::duration time, uint64_t files = 1);
+
+        inline static uint32_t s_QueueDepth = 0;
+        inline static uint32_t s_CreationMask = 0;
+        inline static std::atomic<bool> s_IsIoUringUnavailable = false;
+
+        // First mechanism to try for each pair of source and destination devices
+        inline static std::map<std::pair<uint64_t, uint64_t>, Method> s_DeviceMethods;
+        inline static std::shared_mutex s_Mutex;
+
+        inline static std::array<std::atomic<uint64_t>, size_t(Method::Count)> s_CopiedFiles = {};
+        inline static std::array<std::atomic<uint64_t>, size_t(Method::Count)> s_CopiedBytes = {};
+        inline static std::array<std::atomic<int64_t>, size_t(Method::Count)> s_CopyNanoseconds = {};
+    };
+}
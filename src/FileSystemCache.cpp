@@ -0,0 +1,75 @@
+#include "FileSystemCache.h"
+#include "Logger.h"
+
+
+namespace Hansel
+{
+    bool FileSystemCache::Exists(const Path& path)
+    {
+        return std::filesystem::exists(GetStatus(path));
+    }
+
+    bool FileSystemCache::IsDirectory(const Path& path)
+    {
+        return std::filesystem::is_directory(GetStatus(path));
+    }
+
+    bool FileSystemCache::IsRegularFile(const Path& path)
+    {
+        return std::filesystem::is_regular_file(GetStatus(path));
+    }
+
+    Path FileSystemCache::Canonical(const Path& path)
+    {
+        {
+            std::shared_lock<std::shared_mutex> lock(s_Mutex);
+
+            const auto it = s_CanonicalPaths.find(path);
+            if (it != s_CanonicalPaths.end())
+            {
+                s_Hits++;
+                if (it->second.error)
+                    throw std::filesystem::filesystem_error("canonical", path, it->second.error);
+                return it->second.path;
+            }
+        }
+
+        s_Misses++;
+        CanonicalEntry entry;
+        entry.path = std::filesystem::canonical(path, entry.error).string();
+
+        std::unique_lock<std::shared_mutex> lock(s_Mutex);
+        const CanonicalEntry& cached_entry = s_CanonicalPaths.try_emplace(path, std::move(entry)).first->second;
+        if (cached_entry.error)
+            throw std::filesystem::filesystem_error("canonical", path, cached_entry.error);
+        return cached_entry.path;
+    }
+
+    void FileSystemCache::PrintStatistics()
+    {
+        Logger::InfoVerbose("Filesystem metadata cache: {} calls avoided, {} performed", s_Hits.load(), s_Misses.load());
+    }
+
+
+    std::filesystem::file_status FileSystemCache::GetStatus(const Path& path)
+    {
+        {
+            std::shared_lock<std::shared_mutex> lock(s_Mutex);
+
+            const auto it = s_Statuses.find(path);
+            if (it != s_Statuses.end())
+            {
+                s_Hits++;
+                return it->second;
+            }
+        }
+
+        // A missing path is not an error here, its 'not_found' status is cached as any other
+        s_Misses++;
+        std::error_code err;
+        const std::filesystem::file_status status = std::filesystem::status(path, err);
+
+        std::unique_lock<std::shared_mutex> lock(s_Mutex);
+        return s_Statuses.try_emplace(path, status).first->second;
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "Types.h"
+
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+
+namespace Hansel
+{
+    /* Process-wide cache of filesystem metadata (type and canonical form of paths), shared by all threads.
+       Failed lookups are cached as well, so probing the same missing path again doesn't reach the filesystem.
+       The source tree is assumed not to change while breadcrumbs are being parsed, entries are never invalidated. */
+    class FileSystemCache
+    {
+    public:
+
+        static bool Exists(const Path& path);
+        static bool IsDirectory(const Path& path);
+        static bool IsRegularFile(const Path& path);
+
+        /* Returns the canonical form of 'path', like std::filesystem::canonical().
+           Throws an std::filesystem::filesystem_error if the path doesn't exist or cannot be resolved. */
+        static Path Canonical(const Path& path);
+
+        // Prints the number of filesystem calls that have been avoided (verbose only)
+        static void PrintStatistics();
+
+    private:
+
+        struct CanonicalEntry
+        {
+            Path path;
+            std::error_code error;
+        };
+
+        static std::filesystem::file_status GetStatus(const Path& path);
+
+        inline static std::unordered_map<Path, std::filesystem::file_status> s_Statuses;
+        inline static std::unordered_map<Path, CanonicalEntry> s_CanonicalPaths;
+        inline static std::shared_mutex s_Mutex;
+
+        inline static std::atomic<uint32_t> s_Hits = 0;
+        inline static std::atomic<uint32_t> s_Misses = 0;
+    };
+}
@@ -0,0 +1,131 @@
+#include "GlobPattern.h"
+
+#include <cstdint>
+
+
+namespace Hansel
+{
+    GlobPattern::GlobPattern(const String& pattern)
+        : pattern(pattern)
+    {
+        const size_t n = pattern.size();
+        size_t i = 0;
+
+        while (i < n)
+        {
+            const char c = pattern[i++];
+            if (c == '*')
+            {
+                // Consecutive stars are equivalent to a single one
+                if (tokens.empty() || tokens.back().type != Token::Type::AnyString)
+                    tokens.push_back(Token{ Token::Type::AnyString, 0, 0 });
+                is_literal = false;
+            }
+            else if (c == '?')
+            {
+                tokens.push_back(Token{ Token::Type::AnyChar, 0, 0 });
+                is_literal = false;
+            }
+            else if (c == '[')
+            {
+                // Find the end of the class, a ']' right after the opening bracket (or after '!') is part of it
+                size_t j = i;
+                if (j < n && pattern[j] == '!')
+                    j++;
+                if (j < n && pattern[j] == ']')
+                    j++;
+                while (j < n && pattern[j] != ']')
+                    j++;
+
+                if (j >= n)
+                {
+                    tokens.push_back(Token{ Token::Type::Literal, c, 0 });
+                    continue;
+                }
+
+                std::bitset<256> char_class;
+                const bool negated = pattern[i] == '!';
+                size_t k = negated ? i + 1 : i;
+                while (k < j)
+                {
+                    const unsigned char first = static_cast<unsigned char>(pattern[k]);
+                    if (k + 2 < j && pattern[k + 1] == '-')
+                    {
+                        const unsigned char last = static_cast<unsigned char>(pattern[k + 2]);
+                        for (unsigned int ch = first; ch <= last; ch++)
+                            char_class.set(ch);
+                        k += 3;
+                    }
+                    else
+                    {
+                        char_class.set(first);
+                        k++;
+                    }
+                }
+                if (negated)
+                    char_class.flip();
+
+                tokens.push_back(Token{ Token::Type::CharClass, 0, classes.size() });
+                classes.push_back(char_class);
+                is_literal = false;
+                i = j + 1;
+            }
+            else
+            {
+                tokens.push_back(Token{ Token::Type::Literal, c, 0 });
+            }
+        }
+    }
+
+    bool GlobPattern::Match(std::string_view name) const
+    {
+        if (is_literal)
+            return name == pattern;
+
+        // Greedy matching which, on a mismatch, backtracks to the last star and lets it consume one more character.
+        // Earlier stars never need to be revisited, so the worst case is O(tokens * name) without any allocation.
+        size_t t = 0, s = 0;
+        size_t star_token = SIZE_MAX, star_name = 0;
+
+        while (s < name.size())
+        {
+            if (t < tokens.size() && tokens[t].type == Token::Type::AnyString)
+            {
+                star_token = t++;
+                star_name = s;
+            }
+            else if (t < tokens.size() && MatchToken(tokens[t], name[s]))
+            {
+                t++;
+                s++;
+            }
+            else if (star_token != SIZE_MAX)
+            {
+                t = star_token + 1;
+                s = ++star_name;
+            }
+            else
+            {
+                return false;
+            }
+        }
+
+        // Trailing stars can match an empty sequence
+        while (t < tokens.size() && tokens[t].type == Token::Type::AnyString)
+            t++;
+
+        return t == tokens.size();
+    }
+
+
+    bool GlobPattern::MatchToken(const Token& token, char c) const
+    {
+        switch (token.type)
+        {
+            case Token::Type::Literal:      return token.literal == c;
+            case Token::Type::AnyChar:      return true;
+            case Token::Type::CharClass:    return classes[token.class_index].test(static_cast<unsigned char>(c));
+            default:                        return false;
+        }
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Types.h"
+
+#include <bitset>
+#include <string_view>
+
+
+namespace Hansel
+{
+    /* Unix-style wildcard pattern (as in fnmatch), compiled once and then matched against any number of names.
+       Supports '*' (any sequence of characters), '?' (any single character) and '[...]' character classes,
+        with ranges (e.g. '[a-z]') and negation ('[!...]'); an unterminated '[' matches itself.
+       Matching is case-sensitive and is done on a single path component (i.e. a file or directory name). */
+    class GlobPattern
+    {
+    public:
+
+        GlobPattern() = default;
+        explicit GlobPattern(const String& pattern);
+
+        // Returns true if the whole 'name' matches with the pattern
+        bool Match(std::string_view name) const;
+
+        const String& GetPattern() const { return pattern; }
+
+    private:
+
+        struct Token
+        {
+            enum class Type
+            {
+                Literal,
+                AnyChar,
+                AnyString,
+                CharClass
+            };
+
+            Type    type;
+            char    literal;
+            size_t  class_index;
+        };
+
+        bool MatchToken(const Token& token, char c) const;
+
+        String                      pattern;
+        std::vector<Token>          tokens;
+        std::vector<std::bitset<256>> classes;
+
+        // Patterns without any wildcard are compared directly
+        bool is_literal = true;
+    };
+}
@@ -0,0 +1,260 @@
+#include "InstallManifest.h"
+#include "Logger.h"
+#include "ThreadPool.h"
+#include "Utilities.h"
+
+#include <set>
+#include <sstream>
+
+
+namespace Hansel
+{
+    // First line of manifest files, which identifies the version of their layout
+    static constexpr char INSTALL_MANIFEST_HEADER[] = "HANSEL-MANIFEST 2";
+
+
+    InstallManifest::InstallManifest(const Path& output_directory, bool force)
+        : output_directory(output_directory)
+        , manifest_path(Utilities::CombinePath(output_directory, ".hansel-manifest"))
+        , force(force)
+    {
+        // One tab-separated line per destination file: destination, source, link mode, then size and modification time of both
+        const bool is_valid = Utilities::ReadVersionedFile(manifest_path, INSTALL_MANIFEST_HEADER, "install manifest",
+            [this](const std::vector<std::string>& fields)
+            {
+                std::optional<Entry> entry = ParseEntry(fields);
+                if (entry.has_value())
+                    entries.insert_or_assign(fields[0], std::move(entry.value()));
+                return entry.has_value();
+            });
+        if (!is_valid)
+            entries.clear();
+    }
+
+    bool InstallManifest::IsUpToDate(const Path& source, const Path& destination, Settings::LinkMode link_mode) const
+    {
+        if (force)
+            return false;
+
+        Entry entry;
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex);
+
+            const auto it = entries.find(destination);
+            if (it == entries.end() || it->second.source != source || it->second.link_mode != link_mode)
+                return false;
+            entry = it->second;
+        }
+
+        const std::optional<FileInfo> source_info = Utilities::GetFileInfo(source);
+        const std::optional<FileInfo> destination_info = Utilities::GetFileInfo(destination);
+        if (source_info != entry.source_info || destination_info != entry.destination_info)
+            return false;
+
+        skipped_copies++;
+        return true;
+    }
+
+    void InstallManifest::Record(const Path& source, const Path& destination, Settings::LinkMode link_mode)
+    {
+        performed_copies++;
+
+        const std::optional<FileInfo> source_info = Utilities::GetFileInfo(source);
+        const std::optional<FileInfo> destination_info = Utilities::GetFileInfo(destination);
+
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        if (source_info.has_value() && destination_info.has_value())
+            entries.insert_or_assign(destination, Entry{ source, link_mode, source_info.value(), destination_info.value() });
+        else
+            entries.erase(destination);
+    }
+
+    void InstallManifest::MarkInstalled(const Path& destination)
+    {
+        Path destination_key = Utilities::GetPathKey(destination);
+
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        installed_destinations.insert(std::move(destination_key));
+    }
+
+    bool InstallManifest::Prune(uint32_t thread_count)
+    {
+        std::printf("\nRemoving stale files from '%s'...\n", output_directory.c_str());
+
+        // Files are removed in the order of their paths, so that the output doesn't depend on the manifest layout
+        std::vector<std::pair<Path, Entry>> stale_files;
+        {
+            std::unique_lock<std::shared_mutex> lock(mutex);
+            for (auto it = entries.begin(); it != entries.end();)
+            {
+                if (installed_destinations.contains(Utilities::GetPathKey(it->first)))
+                {
+                    it++;
+                    continue;
+                }
+
+                stale_files.emplace_back(it->first, std::move(it->second));
+                it = entries.erase(it);
+            }
+        }
+        std::sort(stale_files.begin(), stale_files.end(),
+            [](const auto& file, const auto& other_file) { return file.first < other_file.first; });
+
+        if (stale_files.empty())
+        {
+            std::printf("\n  NO STALE FILES\n");
+            return true;
+        }
+
+        std::unique_ptr<ThreadPool> thread_pool;
+        if (thread_count > 1)
+            thread_pool = std::make_unique<ThreadPool>(thread_count - 1);
+
+        std::vector<std::error_code> errors(stale_files.size());
+        std::vector<char> modified(stale_files.size(), false);
+        ThreadPool::ParallelFor(thread_pool.get(), stale_files.size(), [&](size_t i)
+        {
+            bool is_modified = false;
+            errors[i] = RemoveFile(stale_files[i].first, stale_files[i].second, is_modified);
+            modified[i] = is_modified;
+        });
+
+        bool result = true;
+        std::set<Path> directories;
+        const std::filesystem::path root = std::filesystem::path(output_directory).lexically_normal();
+        for (size_t i = 0; i < stale_files.size(); i++)
+        {
+            const Path& path = stale_files[i].first;
+            if (errors[i].value() != 0)
+            {
+                Logger::Error("Unable to remove '{}' ({})", path, errors[i].message());
+                result = false;
+
+                // Keep the file recorded, so that the next installation tries to remove it again
+                std::unique_lock<std::shared_mutex> lock(mutex);
+                entries.emplace(path, std::move(stale_files[i].second));
+                continue;
+            }
+
+            if (modified[i])
+            {
+                Logger::Warn("'{}' has been modified since it was installed and will not be removed", path);
+                continue;
+            }
+
+            if (Logger::IsVerbose())
+                std::printf("Remove file '%s'\n", path.c_str());
+            removed_files++;
+
+            // All the parent directories inside the output directory may have been left empty
+            std::filesystem::path directory = std::filesystem::path(path).parent_path();
+            while (directory.has_relative_path())
+            {
+                const std::filesystem::path relative_directory = directory.lexically_normal().lexically_relative(root);
+                if (relative_directory.empty() || relative_directory == "." || *relative_directory.begin() == "..")
+                    break;
+
+                if (!directories.insert(directory.string()).second)
+                    break;  // the other parents have been added already
+                directory = directory.parent_path();
+            }
+        }
+
+        // Remove the directories one level at a time, from the deepest one, since a directory can only
+        //  be empty once its sub-directories have been removed (non-empty directories are simply kept)
+        std::map<size_t, std::vector<Path>, std::greater<size_t>> directory_levels;
+        for (const Path& directory : directories)
+        {
+            const std::filesystem::path directory_path(directory);
+            directory_levels[size_t(std::distance(directory_path.begin(), directory_path.end()))].push_back(directory);
+        }
+
+        for (const auto& [level, level_directories] : directory_levels)
+        {
+            std::vector<char> removed(level_directories.size(), false);
+            ThreadPool::ParallelFor(thread_pool.get(), level_directories.size(), [&](size_t i)
+            {
+                std::error_code err;
+                removed[i] = std::filesystem::remove(std::filesystem::path(level_directories[i]), err);
+            });
+
+            removed_directories += uint32_t(std::count(removed.begin(), removed.end(), true));
+        }
+
+        return result;
+    }
+
+    void InstallManifest::Save() const
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+
+        std::stringstream buffer;
+        buffer << INSTALL_MANIFEST_HEADER << '\n';
+        for (const auto& [destination, entry] : entries)
+        {
+            buffer << destination << '\t' << entry.source << '\t' << uint32_t(entry.link_mode) << '\t'
+                << entry.source_info.size << '\t' << entry.source_info.modification_time << '\t'
+                << entry.destination_info.size << '\t' << entry.destination_info.modification_time << '\n';
+        }
+
+        const std::error_code err = Utilities::WriteFileAtomically(manifest_path, buffer.str());
+        if (err.value() != 0)
+            Logger::Warn("Unable to write the install manifest '{}' ({})", manifest_path, err.message());
+    }
+
+    void InstallManifest::PrintStatistics() const
+    {
+        Logger::InfoVerbose("Install manifest: {} files up-to-date, {} installed, {} stale files and {} directories removed",
+            skipped_copies.load(), performed_copies.load(), removed_files, removed_directories);
+    }
+
+
+    std::optional<InstallManifest::Entry> InstallManifest::ParseEntry(const std::vector<std::string>& fields)
+    {
+        if (fields.size() != 7)
+            return {};
+
+        Entry entry;
+        entry.source = fields[1];
+
+        unsigned long link_mode = 0;
+        try
+        {
+            link_mode = std::stoul(fields[2]);
+            entry.source_info = FileInfo{ std::stoull(fields[3]), std::stoll(fields[4]) };
+            entry.destination_info = FileInfo{ std::stoull(fields[5]), std::stoll(fields[6]) };
+        }
+        catch (const std::exception&)
+        {
+            return {};  // not a number, or out of range
+        }
+
+        if (link_mode > static_cast<unsigned long>(Settings::LinkMode::Auto))
+            return {};
+
+        entry.link_mode = Settings::LinkMode(link_mode);
+        return entry;
+    }
+
+    std::error_code InstallManifest::RemoveFile(const Path& path, const Entry& entry, bool& modified) const
+    {
+        const std::filesystem::path file_path(path);
+
+        std::error_code err;
+        const std::filesystem::file_status status = std::filesystem::symlink_status(file_path, err);
+        if (!std::filesystem::exists(status))
+            return {};  // already removed
+
+        // Removing a link never loses any data, otherwise the file must be the one which has been installed
+        const bool is_link = std::filesystem::is_symlink(status) ||
+            (std::filesystem::is_regular_file(status) && std::filesystem::hard_link_count(file_path, err) > 1 && err.value() == 0);
+        if (!is_link && Utilities::GetFileInfo(path) != entry.destination_info)
+        {
+            modified = true;
+            return {};
+        }
+
+        std::filesystem::remove(file_path, err);
+        return err;
+    }
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "Types.h"
+#include "Utilities.h"
+
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <unordered_set>
+
+
+namespace Hansel
+{
+    /* Record of the files installed in an output directory, stored in the directory itself (.hansel-manifest).
+       For each destination file it keeps the source which it has been copied (or linked) from, how it has been
+        installed, and the size and modification time of both, so that a later installation can skip the copies
+        whose source hasn't changed and whose destination hasn't been modified or removed in the meantime, and
+        the files which are not installed anymore can be removed.
+       It can be queried and updated concurrently by the threads which execute an InstallPlan. */
+    class InstallManifest
+    {
+    public:
+
+        /* Loads the manifest of 'output_directory', if there is a valid one.
+           With 'force', files are never considered up-to-date but the manifest is still updated. */
+        InstallManifest(const Path& output_directory, bool force);
+
+        // Returns true if 'destination' has been installed from 'source' in the same way, and neither of them has changed since then
+        bool IsUpToDate(const Path& source, const Path& destination, Settings::LinkMode link_mode) const;
+
+        // Records that 'destination' has just been installed from 'source'
+        void Record(const Path& source, const Path& destination, Settings::LinkMode link_mode);
+
+        /* Marks 'destination' as part of the current installation (whether it's up-to-date or not), see Prune().
+           Destinations are marked when the installation is planned, or when they are listed for those which aren't
+            known in advance (files of directories and of patterns expanded after commands). */
+        void MarkInstalled(const Path& destination);
+
+        /* Removes the files recorded by the previous installations which are not part of the current one, with
+            the given number of threads, then the directories which have been left empty (up to the output directory).
+           Files which have been modified since they were installed are kept, and no longer recorded.
+           Returns false if any of the files couldn't be removed, errors are logged in the order of the paths. */
+        bool Prune(uint32_t thread_count);
+
+        // Writes the manifest back to the output directory, replacing the previous one
+        void Save() const;
+
+        // Prints the number of copies which have been skipped and performed, and of the removed files (verbose only)
+        void PrintStatistics() const;
+
+    private:
+
+        using FileInfo = Utilities::FileInfo;
+
+        struct Entry
+        {
+            Path     source;
+            Settings::LinkMode link_mode = Settings::LinkMode::Copy;
+            FileInfo source_info;
+            FileInfo destination_info;
+        };
+
+        // Returns the entry described by the fields of a manifest line, or nothing if they are not valid
+        static std::optional<Entry> ParseEntry(const std::vector<std::string>& fields);
+
+        // Removes an installed file, unless it has been modified since it was recorded
+        std::error_code RemoveFile(const Path& path, const Entry& entry, bool& modified) const;
+
+        const Path output_directory;
+        const Path manifest_path;
+        const bool force;
+
+        std::unordered_map<Path, Entry> entries;
+        // Normalized paths (see Utilities::GetPathKey()) of the destinations which are part of the current installation
+        std::unordered_set<Path> installed_destinations;
+        mutable std::shared_mutex mutex;
+
+        mutable std::atomic<uint32_t> skipped_copies = 0;
+        std::atomic<uint32_t> performed_copies = 0;
+        uint32_t removed_files = 0;
+        uint32_t removed_directories = 0;
+    };
+}
@@ -0,0 +1,690 @@
+#include "InstallPlan.h"
+#include "FileCopier.h"
+#include "Logger.h"
+#include "ProcessRunner.h"
+#include "Utilities.h"
+
+#include <algorithm>
+#include <iostream>
+
+
+namespace Hansel
+{
+    static bool IsSubPath(const Path& path_key, const Path& directory_key)
+    {
+        return path_key.size() > directory_key.size() && path_key.starts_with(directory_key) &&
+            path_key[directory_key.size()] == '/';
+    }
+
+    static bool IsLink(const std::filesystem::path& path)
+    {
+        std::error_code err;
+        const std::filesystem::file_status status = std::filesystem::symlink_status(path, err);
+        if (std::filesystem::is_symlink(status))
+            return true;
+        if (!std::filesystem::is_regular_file(status))
+            return false;
+
+        const uintmax_t link_count = std::filesystem::hard_link_count(path, err);
+        return err.value() == 0 && link_count > 1;
+    }
+
+
+    InstallPlan::InstallPlan(bool debug, bool verbose, Settings::LinkMode link_mode, InstallManifest* manifest,
+        ContentStore* store, uint32_t max_processes, CommandStamps* stamps)
+        : debug(debug), verbose(verbose), link_mode(link_mode), manifest(manifest), store(store), max_processes(max_processes)
+        , stamps(stamps)
+    {}
+
+    void InstallPlan::AddMessage(const String& message)
+    {
+        if (debug || verbose)
+            GetCurrentStage().messages.push_back(message);
+    }
+
+    void InstallPlan::AddDirectoryCreation(const Path& directory)
+    {
+        GetCurrentStage();
+
+        // Each directory is created only once per stage, by the first action which needs it
+        const Path directory_key = Utilities::GetPathKey(directory);
+        if (!created_directories.contains(directory_key))
+            created_directories.emplace(directory_key, AddAction(Action{ Action::Type::DirectoryCreation, {}, directory }));
+    }
+
+    void InstallPlan::AddFileCopy(const Path& source, const Path& destination)
+    {
+        // Destinations are kept by Prune() even if they are not installed (e.g. because of an error)
+        if (manifest)
+            manifest->MarkInstalled(destination);
+
+        if (IsRedundantCopy(Action::Type::FileCopy, source, destination))
+        {
+            std::error_code err;
+            const uintmax_t size = std::filesystem::file_size(std::filesystem::path(source), err);
+
+            redundant_file_copies++;
+            redundant_file_bytes += (err.value() == 0) ? uint64_t(size) : 0;
+            return;
+        }
+
+        const Path directory = std::filesystem::path(destination).parent_path().string();
+        AddDirectoryCreation(directory);
+
+        const size_t index = AddAction(Action{ Action::Type::FileCopy, source, destination });
+        AddDependency(created_directories.at(Utilities::GetPathKey(directory)), index);
+    }
+
+    void InstallPlan::AddDirectoryCopy(const Path& source, const Path& destination)
+    {
+        if (IsRedundantCopy(Action::Type::DirectoryCopy, source, destination))
+        {
+            redundant_directory_copies++;
+            return;
+        }
+
+        AddDirectoryCreation(destination);
+
+        const size_t index = AddAction(Action{ Action::Type::DirectoryCopy, source, destination });
+        AddDependency(created_directories.at(Utilities::GetPathKey(destination)), index);
+    }
+
+    void InstallPlan::AddFilesCopy(const PathPattern& pattern, const Path& destination)
+    {
+        AddDirectoryCreation(destination);
+
+        Action action{ Action::Type::FilesCopy, pattern.GetBaseDirectory(), destination };
+        action.pattern = &pattern;
+        const size_t index = AddAction(std::move(action));
+        AddDependency(created_directories.at(Utilities::GetPathKey(destination)), index);
+    }
+
+    bool InstallPlan::FollowsCommands()
+    {
+        if (debug)
+            return false;
+
+        // The commands of the current stage run after its actions
+        GetCurrentStage();
+        return std::any_of(stages.begin(), stages.end() - 1, [](const Stage& stage) { return !stage.commands.empty(); });
+    }
+
+    void InstallPlan::AddCommand(const String& message, const String& command_line,
+        const std::vector<Path>& inputs, const std::vector<Path>& outputs)
+    {
+        GetCurrentStage().commands.push_back(Command{ message, command_line, open_scopes.back(), inputs, outputs });
+    }
+
+    void InstallPlan::BeginScope()
+    {
+        open_scopes.push_back(scope_parents.size());
+        scope_parents.push_back(open_scopes[open_scopes.size() - 2]);
+    }
+
+    void InstallPlan::EndScope()
+    {
+        if (open_scopes.size() > 1)
+            open_scopes.pop_back();
+    }
+
+    bool InstallPlan::Execute(uint32_t thread_count)
+    {
+        Logger::InfoVerbose("Install plan: {} actions, {} redundant file copies ({} bytes) and {} directory copies removed",
+            actions.size(), redundant_file_copies, redundant_file_bytes, redundant_directory_copies);
+
+        std::unique_ptr<ThreadPool> thread_pool;
+        if (!debug && thread_count > 1)
+            thread_pool = std::make_unique<ThreadPool>(thread_count - 1);
+
+        bool result = true;
+        for (const Stage& stage : stages)
+        {
+            for (const String& message : stage.messages)
+                std::printf("%s", message.c_str());
+
+            if (!debug)     // in Debug mode, only print the messages
+            {
+                CreateDirectories(stage, thread_pool.get());
+                if (link_mode == Settings::LinkMode::Copy && !store && FileCopier::GetQueueDepth() > 0)
+                    CopyFilesInBatches(stage, thread_pool.get());
+                ExecuteActions(stage, thread_pool.get());
+
+                for (size_t i = stage.first_action; i < stage.end_action; i++)
+                {
+                    if (actions[i].exception)
+                    {
+                        try
+                        {
+                            std::rethrow_exception(actions[i].exception);
+                        }
+                        catch (const std::exception& e)
+                        {
+                            Logger::Error(e.what());
+                        }
+                        result = false;
+                    }
+                    else if (actions[i].error.value() != 0)
+                    {
+                        Logger::Error(actions[i].error.message());
+                        result = false;
+                    }
+                }
+            }
+
+            if (!stage.commands.empty() && !ExecuteCommands(stage))
+                result = false;
+        }
+        return result;
+    }
+
+
+    InstallPlan::Stage& InstallPlan::GetCurrentStage()
+    {
+        // A command closes the stage (for its scope), the actions which follow it can only start once it has completed
+        if (stages.empty() || !CanJoinStage(stages.back()))
+        {
+            Stage& stage = stages.emplace_back();
+            stage.first_action = stage.end_action = actions.size();
+
+            last_access.clear();
+            last_write.clear();
+            last_directory_copy.clear();
+            created_directories.clear();
+        }
+        return stages.back();
+    }
+
+    bool InstallPlan::CanJoinStage(const Stage& stage) const
+    {
+        if (max_processes <= 1)
+            return stage.commands.empty();
+
+        for (const Command& command : stage.commands)
+        {
+            if (IsSameOrParentScope(open_scopes.back(), command.scope))
+                return false;
+        }
+        return true;
+    }
+
+    bool InstallPlan::IsSameOrParentScope(size_t scope, size_t other_scope) const
+    {
+        while (other_scope != scope && other_scope != 0)
+            other_scope = scope_parents[other_scope];
+        return other_scope == scope;
+    }
+
+    size_t InstallPlan::AddAction(Action action)
+    {
+        Stage& stage = GetCurrentStage();
+
+        const size_t index = actions.size();
+        // The files matched by a pattern are only known once it's expanded, its whole base directory is accessed
+        const bool is_directory_copy = action.type == Action::Type::DirectoryCopy || action.type == Action::Type::FilesCopy;
+        actions.push_back(std::move(action));
+        stage.end_action = actions.size();
+
+        if (actions[index].type == Action::Type::DirectoryCreation)
+            return index;   // creating a directory never conflicts with the other actions
+
+        // Order the action after the previous ones which have accessed the same paths, either directly
+        //  or as part of a directory tree, reading and writing are not distinguished
+        for (const Path& path : { actions[index].source, actions[index].destination })
+        {
+            const Path path_key = Utilities::GetPathKey(path);
+
+            const auto access_it = last_access.find(path_key);
+            if (access_it != last_access.end())
+                AddDependency(access_it->second, index);
+
+            std::filesystem::path parent_path = std::filesystem::path(path_key).parent_path();
+            while (!parent_path.empty())
+            {
+                const auto copy_it = last_directory_copy.find(parent_path.string());
+                if (copy_it != last_directory_copy.end())
+                    AddDependency(copy_it->second, index);
+
+                if (parent_path == parent_path.parent_path())
+                    break;
+                parent_path = parent_path.parent_path();
+            }
+
+            if (is_directory_copy)
+            {
+                for (const auto& [other_key, other_index] : last_access)
+                {
+                    if (IsSubPath(other_key, path_key))
+                        AddDependency(other_index, index);
+                }
+            }
+        }
+
+        for (const Path& path : { actions[index].source, actions[index].destination })
+        {
+            const Path path_key = Utilities::GetPathKey(path);
+            last_access.insert_or_assign(path_key, index);
+            if (is_directory_copy)
+                last_directory_copy.insert_or_assign(path_key, index);
+        }
+        last_write.insert_or_assign(Utilities::GetPathKey(actions[index].destination), index);
+
+        return index;
+    }
+
+    void InstallPlan::AddDependency(size_t predecessor, size_t successor)
+    {
+        // All the dependencies of an action are added together, so a duplicate would be the last one
+        std::vector<size_t>& successors = actions[predecessor].successors;
+        if (predecessor == successor || (!successors.empty() && successors.back() == successor))
+            return;
+
+        successors.push_back(successor);
+        actions[successor].predecessor_count++;
+    }
+
+    bool InstallPlan::IsRedundantCopy(Action::Type type, const Path& source, const Path& destination) const
+    {
+        // A command closes the stage, so it's never known what it has done with the previous copies
+        if (stages.empty() || !CanJoinStage(stages.back()))
+            return false;
+
+        const Path source_key = Utilities::GetPathKey(source);
+        const Path destination_key = Utilities::GetPathKey(destination);
+
+        const auto write_it = last_write.find(destination_key);
+        if (write_it == last_write.end())
+            return false;
+
+        const size_t previous = write_it->second;
+        if (actions[previous].type != type || Utilities::GetPathKey(actions[previous].source) != source_key)
+            return false;
+
+        // The contents of a directory copy can also be changed by the actions which write inside of it
+        const bool include_sub_paths = (type == Action::Type::DirectoryCopy);
+        return !IsWrittenAfter(source_key, previous, include_sub_paths) &&
+            !IsWrittenAfter(destination_key, previous, include_sub_paths);
+    }
+
+    bool InstallPlan::IsWrittenAfter(const Path& path_key, size_t index, bool include_sub_paths) const
+    {
+        const auto write_it = last_write.find(path_key);
+        if (write_it != last_write.end() && write_it->second > index)
+            return true;
+
+        // Directory copies (either from or to a parent directory) are conservatively treated as writes
+        std::filesystem::path parent_path = std::filesystem::path(path_key).parent_path();
+        while (!parent_path.empty())
+        {
+            const auto copy_it = last_directory_copy.find(parent_path.string());
+            if (copy_it != last_directory_copy.end() && copy_it->second > index)
+                return true;
+
+            if (parent_path == parent_path.parent_path())
+                break;
+            parent_path = parent_path.parent_path();
+        }
+
+        if (include_sub_paths)
+        {
+            for (const auto& [other_key, other_index] : last_write)
+            {
+                if (other_index > index && IsSubPath(other_key, path_key))
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    void InstallPlan::CreateDirectories(const Stage& stage, ThreadPool* thread_pool)
+    {
+        struct Directory
+        {
+            std::filesystem::path path;
+            Path key;
+            Path parent_key;    // empty for the root directory
+        };
+
+        // Gather the directories of the stage together with all their parents, grouped by depth
+        std::vector<std::vector<Directory>> levels;
+        std::unordered_map<Path, std::error_code> results;
+        for (size_t i = stage.first_action; i < stage.end_action; i++)
+        {
+            if (actions[i].type != Action::Type::DirectoryCreation)
+                continue;
+
+            std::filesystem::path path = std::filesystem::path(actions[i].destination).lexically_normal();
+            if (!path.has_filename() && path.has_relative_path())
+                path = path.parent_path();  // trailing separator
+
+            while (!path.empty())
+            {
+                const bool is_root = !path.has_relative_path();
+                Directory directory{ path, Utilities::GetPathKey(path.string()), is_root ? Path() : Utilities::GetPathKey(path.parent_path().string()) };
+                if (!results.try_emplace(directory.key).second)
+                    break;  // its parents have been added already
+
+                const size_t depth = size_t(std::distance(path.begin(), path.end()));
+                if (levels.size() < depth + 1)
+                    levels.resize(depth + 1);
+                levels[depth].push_back(std::move(directory));
+
+                if (is_root)
+                    break;
+                path = path.parent_path();
+            }
+        }
+
+        // Each directory is created with a single call, once its parent exists
+        for (const std::vector<Directory>& level : levels)
+        {
+            std::vector<std::error_code> errors(level.size());
+            ThreadPool::ParallelFor(thread_pool, level.size(), [&](size_t i)
+            {
+                const auto parent_it = results.find(level[i].parent_key);
+                if (parent_it != results.end() && parent_it->second.value() != 0)
+                    errors[i] = parent_it->second;   // it can't be created if its parent couldn't
+                else
+                    std::filesystem::create_directory(level[i].path, errors[i]);
+            });
+
+            for (size_t i = 0; i < level.size(); i++)
+                results[level[i].key] = errors[i];
+        }
+
+        for (size_t i = stage.first_action; i < stage.end_action; i++)
+        {
+            if (actions[i].type == Action::Type::DirectoryCreation)
+                actions[i].error = results[Utilities::GetPathKey(actions[i].destination)];
+        }
+    }
+
+    void InstallPlan::ExecuteActions(const Stage& stage, ThreadPool* thread_pool)
+    {
+        const size_t count = stage.end_action - stage.first_action;
+        if (count == 0)
+            return;
+
+        // Without a thread pool, the actions run in the order in which they have been planned
+        if (!thread_pool)
+        {
+            for (size_t i = stage.first_action; i < stage.end_action; i++)
+                ExecuteAction(actions[i]);
+            return;
+        }
+
+        std::vector<std::atomic<uint32_t>> remaining_predecessors(count);
+        for (size_t i = 0; i < count; i++)
+            remaining_predecessors[i] = actions[stage.first_action + i].predecessor_count;
+
+        std::atomic<size_t> remaining_actions = count;
+        std::promise<void> completed;
+        const std::future<void> completed_future = completed.get_future();
+
+        // Each action schedules the successors which it has made ready, ExecuteAction() doesn't throw
+        //  (failures are stored in the actions) so that all of them complete
+        std::function<void(size_t)> execute = [&](size_t index)
+        {
+            ExecuteAction(actions[index]);
+
+            for (const size_t successor : actions[index].successors)
+            {
+                if (--remaining_predecessors[successor - stage.first_action] == 0)
+                    thread_pool->Submit([&execute, successor]() { execute(successor); });
+            }
+
+            if (--remaining_actions == 0)
+                completed.set_value();
+        };
+
+        for (size_t i = stage.first_action; i < stage.end_action; i++)
+        {
+            if (actions[i].predecessor_count == 0)
+                thread_pool->Submit([&execute, i]() { execute(i); });
+        }
+
+        thread_pool->Wait(completed_future);
+    }
+
+    void InstallPlan::CopyFilesInBatches(const Stage& stage, ThreadPool* thread_pool)
+    {
+        // Copies which follow anything other than the creation of a directory, or which are followed by other actions,
+        //  keep their place in the ordering of the stage
+        std::vector<bool> is_ordered(stage.end_action - stage.first_action, false);
+        for (size_t i = stage.first_action; i < stage.end_action; i++)
+        {
+            if (actions[i].type == Action::Type::DirectoryCreation)
+                continue;
+
+            for (const size_t successor : actions[i].successors)
+                is_ordered[successor - stage.first_action] = true;
+        }
+
+        std::vector<size_t> batched_actions;
+        for (size_t i = stage.first_action; i < stage.end_action; i++)
+        {
+            if (actions[i].type == Action::Type::FileCopy && actions[i].successors.empty() &&
+                !is_ordered[i - stage.first_action])
+            {
+                batched_actions.push_back(i);
+            }
+        }
+        if (batched_actions.size() < 2)
+            return;
+
+        // Each thread copies a contiguous share of the files with its own ring
+        const size_t batch_count = std::min<size_t>(batched_actions.size(), thread_pool ? thread_pool->GetThreadCount() + 1 : 1);
+        ThreadPool::ParallelFor(thread_pool, batch_count, [&](size_t batch)
+        {
+            const size_t first = batched_actions.size() * batch / batch_count;
+            const size_t last = batched_actions.size() * (batch + 1) / batch_count;
+
+            std::vector<size_t> copied_actions;
+            std::vector<std::pair<Path, Path>> files;
+            for (size_t i = first; i < last; i++)
+            {
+                Action& action = actions[batched_actions[i]];
+                action.executed = true;
+
+                if (PrepareInstall(action.source, action.destination, action.error))
+                {
+                    copied_actions.push_back(batched_actions[i]);
+                    files.emplace_back(action.source, action.destination);
+                }
+            }
+
+            const std::vector<std::error_code> errors = FileCopier::CopyFiles(files);
+            for (size_t i = 0; i < copied_actions.size(); i++)
+            {
+                Action& action = actions[copied_actions[i]];
+                action.error = errors[i];
+                CompleteInstall(action.source, action.destination, action.error);
+            }
+        });
+    }
+
+    void InstallPlan::ExecuteAction(Action& action)
+    {
+        if (action.executed)
+            return;
+
+        try
+        {
+            switch (action.type)
+            {
+                case Action::Type::DirectoryCreation:
+                    break;  // already created, see CreateDirectories()
+
+                case Action::Type::FileCopy:
+                    action.error = InstallFile(action.source, action.destination);
+                    break;
+
+                case Action::Type::DirectoryCopy:
+                    action.error = Utilities::CopyDirectory(action.source, action.destination,
+                        [this](const Path& source, const Path& destination)
+                        {
+                            if (manifest)
+                                manifest->MarkInstalled(destination);
+                            return InstallFile(source, destination);
+                        });
+                    break;
+
+                case Action::Type::FilesCopy:
+                    action.error = CopyMatchingFiles(*action.pattern, action.destination);
+                    break;
+            }
+        }
+        catch (...)
+        {
+            action.exception = std::current_exception();
+        }
+    }
+
+    std::error_code InstallPlan::CopyMatchingFiles(const PathPattern& pattern, const Path& destination)
+    {
+        // Not through the ExpansionCache, which may hold the files listed before the commands have run
+        for (const Path& file_path : pattern.Expand())
+        {
+            const Path file_destination = Utilities::GetDestinationPath(destination, file_path, pattern.GetBaseDirectory());
+            if (manifest)
+                manifest->MarkInstalled(file_destination);
+
+            // Files matched in sub-directories keep their sub-path, whose directories haven't been planned
+            std::error_code err;
+            std::filesystem::create_directories(std::filesystem::path(file_destination).parent_path(), err);
+            if (err.value() == 0)
+                err = InstallFile(file_path, file_destination);
+            if (err.value() != 0)
+                return err;
+        }
+        return {};
+    }
+
+    std::error_code InstallPlan::InstallFile(const Path& source, const Path& destination)
+    {
+        std::error_code err;
+        if (!PrepareInstall(source, destination, err))
+            return err;
+
+        if (link_mode != Settings::LinkMode::Copy)
+            err = LinkFile(source, destination);
+        else err = store ? store->Install(source, destination) : FileCopier::Copy(source, destination);
+        CompleteInstall(source, destination, err);
+        return err;
+    }
+
+    bool InstallPlan::PrepareInstall(const Path& source, const Path& destination, std::error_code& err)
+    {
+        if (manifest && manifest->IsUpToDate(source, destination, link_mode))
+            return false;
+
+        if (link_mode == Settings::LinkMode::Copy && IsLink(std::filesystem::path(destination)))
+        {
+            // A link left by a previous installation is replaced, copying through it would overwrite its target
+            std::filesystem::remove(std::filesystem::path(destination), err);
+            if (err.value() != 0)
+                return false;
+        }
+        return true;
+    }
+
+    void InstallPlan::CompleteInstall(const Path& source, const Path& destination, const std::error_code& err)
+    {
+        if (manifest && err.value() == 0)
+            manifest->Record(source, destination, link_mode);
+    }
+
+    std::error_code InstallPlan::LinkFile(const Path& source, const Path& destination)
+    {
+        const std::filesystem::path source_path(source);
+        const std::filesystem::path destination_path(destination);
+
+        // Links can't overwrite an existing file, which is removed first
+        std::error_code err;
+        std::filesystem::remove(destination_path, err);
+        if (err.value() != 0)
+            return err;
+
+        if (link_mode == Settings::LinkMode::Symlink)
+        {
+            std::filesystem::create_symlink(std::filesystem::absolute(source_path), destination_path, err);
+            return err;
+        }
+
+        std::filesystem::create_hard_link(source_path, destination_path, err);
+
+        // In Auto mode, files which can't be linked (e.g. because they are on a different file system) are copied
+        if (err.value() != 0 && link_mode == Settings::LinkMode::Auto)
+            return FileCopier::Copy(source, destination);
+        return err;
+    }
+
+    bool InstallPlan::ExecuteCommands(const Stage& stage)
+    {
+        if (debug || verbose)
+        {
+            for (const Command& command : stage.commands)
+                std::printf("%s", command.message.c_str());
+
+            if (debug)  // in Debug mode, return without executing the commands
+                return true;
+        }
+
+        // Commands which declare their inputs or outputs are skipped if they haven't changed since their last successful run
+        std::vector<size_t> executed_commands;
+        std::vector<String> command_lines;
+        std::vector<CommandStamps::Fingerprint> fingerprints(stage.commands.size());
+        for (size_t i = 0; i < stage.commands.size(); i++)
+        {
+            const Command& command = stage.commands[i];
+            if (stamps && (!command.inputs.empty() || !command.outputs.empty()))
+            {
+                fingerprints[i] = CommandStamps::GetFingerprint(command.inputs);
+
+                String reason;
+                if (stamps->IsUpToDate(command.command_line, fingerprints[i], command.outputs, reason))
+                {
+                    Logger::InfoVerbose("Skipping command '{}': its inputs haven't changed since its last successful run", command.command_line);
+                    continue;
+                }
+                Logger::InfoVerbose("Executing command '{}': {}", command.command_line, reason);
+            }
+
+            executed_commands.push_back(i);
+            command_lines.push_back(command.command_line);
+        }
+
+        // The commands may write to the same streams (see ProcessRunner), what has been printed must come first
+        std::cout.flush();
+        std::fflush(stdout);
+        const std::vector<ProcessRunner::Result> results = ProcessRunner::Run(command_lines, max_processes);
+
+        // Captured outputs are printed once all the commands have completed, in the same order as the commands
+        bool result = true;
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const Command& command = stage.commands[executed_commands[i]];
+            if (stamps && (!command.inputs.empty() || !command.outputs.empty()))
+            {
+                const bool succeeded = results[i].error.value() == 0 && results[i].exit_code == 0;
+                stamps->Record(command.command_line, fingerprints[executed_commands[i]], command.outputs, succeeded);
+            }
+
+            std::fwrite(results[i].output.data(), 1, results[i].output.size(), stdout);
+            std::fflush(stdout);
+            std::fwrite(results[i].errors.data(), 1, results[i].errors.size(), stderr);
+            std::fflush(stderr);
+
+            if (results[i].error.value() != 0)
+            {
+                Logger::Error("Unable to execute command '{}': {}", command_lines[i], results[i].error.message());
+                result = false;
+            }
+            else if (results[i].exit_code != 0)
+            {
+                Logger::Error("Command '{}' failed with exit code {}", command_lines[i], results[i].exit_code);
+                result = false;
+            }
+        }
+        return result;
+    }
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include "Types.h"
+#include "CommandStamps.h"
+#include "ContentStore.h"
+#include "InstallManifest.h"
+#include "PathPattern.h"
+#include "ThreadPool.h"
+
+#include <unordered_map>
+
+
+namespace Hansel
+{
+    /* Sequence of the actions performed by the installation of a dependency tree, which is built by a serial
+        traversal of the tree (see Dependency::Plan()) and then executed, possibly in parallel.
+       The plan is split in stages by commands and scripts, which run after the actions of their stage since they
+        could read or modify anything. By default each command closes its stage, so that they all run alone and in
+        order; with more than one process, a stage is only closed for the scopes (libraries and projects) which
+        contain one of its commands, so the commands of independent subtrees share a stage and run concurrently,
+        while those of a library still run after the ones of its sub-dependencies (and after each other).
+        The actions of a subtree can then run before the commands of a previous sibling: its files must not depend
+        on what these commands generate or modify.
+       Within a stage, all the directories are created first (each one only once, parents before their children
+        and the others concurrently), so that copies never check their destination directories; then actions which
+        touch the same paths (or a directory tree containing them) keep their relative order, all the others run
+        concurrently. The installed files are therefore the same as those of a serial install (given the above).
+       Copies which repeat a previous one (e.g. of a library referenced by several breadcrumbs) are dropped,
+        as long as neither their source nor their destination has been written in the meantime.
+       Files patterns are expanded when the plan is built, unless commands run before their stage: the files which
+        these commands generate can only be listed once they have completed, so the expansion is an action of its own.
+       Messages are only recorded in debug or verbose mode, and printed in the same order as they are added.
+       Files are copied or linked to their destination depending on the link mode, and if a manifest is provided,
+        files which are already up-to-date in the destination are not installed again. Copies go through the
+        content store instead, if one is provided.
+       Commands which declare their inputs or outputs are skipped if they are up-to-date according to the stamps
+        (see CommandStamps), when they are provided.
+       When io_uring is enabled (see FileCopier::SetQueueDepth()), the file copies of a stage which don't depend
+        on any other action except the creation of their directory are copied together in batches, one per thread. */
+    class InstallPlan
+    {
+    public:
+
+        InstallPlan(bool debug, bool verbose, Settings::LinkMode link_mode = Settings::LinkMode::Copy,
+            InstallManifest* manifest = nullptr, ContentStore* store = nullptr, uint32_t max_processes = 1,
+            CommandStamps* stamps = nullptr);
+
+        void AddMessage(const String& message);
+
+        // Creates 'directory' and all of its missing parents
+        void AddDirectoryCreation(const Path& directory);
+
+        // Installs 'source' to the 'destination' file path (overwriting it), creating its parent directory first
+        void AddFileCopy(const Path& source, const Path& destination);
+
+        // Recursively copies the contents of the 'source' directory into 'destination' (creating it first), see Utilities::CopyDirectory()
+        void AddDirectoryCopy(const Path& source, const Path& destination);
+
+        /* Installs the files which match with the pattern (see PathPattern::Expand()) when the action is executed,
+            into 'destination' (which is created even if no file matches), see FollowsCommands(). */
+        void AddFilesCopy(const PathPattern& pattern, const Path& destination);
+
+        // Returns true if commands run before the actions added now (never in Debug mode, where they are not executed)
+        bool FollowsCommands();
+
+        /* Executes the command line with the system command processor, printing the message first (if enabled).
+           If it declares any inputs or outputs, it can be skipped as long as they are unchanged. */
+        void AddCommand(const String& message, const String& command_line,
+            const std::vector<Path>& inputs = {}, const std::vector<Path>& outputs = {});
+
+        /* Scopes group the actions of a subtree (e.g. a library and its sub-dependencies), they must be nested.
+           The actions of a scope can share a stage with the commands of another scope, but not with those of
+           its own or of its sub-scopes, which must complete first. */
+        void BeginScope();
+        void EndScope();
+
+        /* Executes the plan with the given number of threads (in Debug mode, only prints the messages).
+           Returns false if any of the actions has failed, errors are logged in the order of the actions. */
+        bool Execute(uint32_t thread_count);
+
+    private:
+
+        struct Action
+        {
+            enum class Type
+            {
+                DirectoryCreation,
+                FileCopy,
+                DirectoryCopy,
+                FilesCopy
+            };
+
+            Type    type = Type::FileCopy;
+            Path    source{};       // base directory of the pattern for FilesCopy actions
+            Path    destination{};
+            const PathPattern* pattern = nullptr;
+
+            std::vector<size_t> successors{};
+            uint32_t predecessor_count = 0;
+
+            std::error_code error{};
+            std::exception_ptr exception{}; // thrown while executing the action (e.g. by the expansion of a pattern)
+            bool executed = false;  // already executed by a batch
+        };
+
+        struct Command
+        {
+            String message;
+            String command_line;
+            size_t scope;
+            std::vector<Path> inputs;
+            std::vector<Path> outputs;
+        };
+
+        struct Stage
+        {
+            std::vector<String> messages;
+            size_t first_action = 0;
+            size_t end_action = 0;
+            std::vector<Command> commands;  // executed after the actions, concurrently
+        };
+
+        Stage& GetCurrentStage();
+
+        // Returns true if the actions of the current scope can be added to the stage, which doesn't contain any of its commands
+        bool CanJoinStage(const Stage& stage) const;
+        bool IsSameOrParentScope(size_t scope, size_t other_scope) const;
+        size_t AddAction(Action action);
+
+        // Adds an ordering constraint between the actions (only once)
+        void AddDependency(size_t predecessor, size_t successor);
+
+        // Returns true if the same copy has already been planned in the current stage, and its result is still in place
+        bool IsRedundantCopy(Action::Type type, const Path& source, const Path& destination) const;
+        bool IsWrittenAfter(const Path& path_key, size_t index, bool include_sub_paths) const;
+
+        void CreateDirectories(const Stage& stage, ThreadPool* thread_pool);
+        void ExecuteActions(const Stage& stage, ThreadPool* thread_pool);
+        void CopyFilesInBatches(const Stage& stage, ThreadPool* thread_pool);
+        void ExecuteAction(Action& action);
+        std::error_code CopyMatchingFiles(const PathPattern& pattern, const Path& destination);
+        std::error_code InstallFile(const Path& source, const Path& destination);
+
+        // Returns true if the file must be installed (false if it's up-to-date or 'err' is set), and prepares its destination
+        bool PrepareInstall(const Path& source, const Path& destination, std::error_code& err);
+        void CompleteInstall(const Path& source, const Path& destination, const std::error_code& err);
+        std::error_code LinkFile(const Path& source, const Path& destination);
+        bool ExecuteCommands(const Stage& stage);
+
+        const bool debug;
+        const bool verbose;
+        const Settings::LinkMode link_mode;
+        InstallManifest* const manifest;
+        ContentStore* const store;
+        const uint32_t max_processes;
+        CommandStamps* const stamps;
+
+        std::vector<Action> actions;
+        std::vector<Stage> stages;
+
+        // Parent of each scope (the root scope is its own parent), and scopes which are currently open
+        std::vector<size_t> scope_parents = { 0 };
+        std::vector<size_t> open_scopes = { 0 };
+
+        // State of the current stage: last action which has accessed (or written) each path, and directories created in it
+        std::unordered_map<Path, size_t> last_access;
+        std::unordered_map<Path, size_t> last_write;
+        std::unordered_map<Path, size_t> last_directory_copy;
+        std::unordered_map<Path, size_t> created_directories;
+
+        uint32_t redundant_file_copies = 0;
+        uint64_t redundant_file_bytes = 0;
+        uint32_t redundant_directory_copies = 0;
+    };
+}
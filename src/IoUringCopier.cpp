@@ -0,0 +1,320 @@
+#include "IoUringCopier.h"
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+
+namespace Hansel
+{
+    // Requests submitted for a file, stored in the lowest bits of their user data
+    enum class Operation : uint64_t
+    {
+        Read,
+        Write,
+        CloseSource,
+        CloseDestination
+    };
+
+    static constexpr uint64_t OPERATION_BITS = 2;
+    static constexpr uint32_t REQUESTS_PER_FILE = 4;
+
+    struct IoUringCopier::FileState
+    {
+        int source_fd = -1;
+        int destination_fd = -1;
+        uint64_t size = 0;
+        bool has_failed = false;
+    };
+
+
+    static int SetupRing(uint32_t entries, io_uring_params* params)
+    {
+        return int(syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    static int EnterRing(int ring_fd, uint32_t to_submit, uint32_t min_complete, uint32_t flags)
+    {
+        return int(syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0));
+    }
+
+    static int RegisterRing(int ring_fd, uint32_t opcode, void* arg, uint32_t count)
+    {
+        return int(syscall(__NR_io_uring_register, ring_fd, opcode, arg, count));
+    }
+
+    static uint64_t MakeUserData(size_t file, Operation operation)
+    {
+        return (uint64_t(file) << OPERATION_BITS) | uint64_t(operation);
+    }
+
+
+    IoUringCopier::IoUringCopier(uint32_t queue_depth, mode_t creation_mask)
+        : creation_mask(creation_mask)
+    {
+        if (!Setup(queue_depth))
+            Close();
+    }
+
+    IoUringCopier::~IoUringCopier()
+    {
+        Close();
+    }
+
+    bool IoUringCopier::Setup(uint32_t queue_depth)
+    {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+
+        const int fd = SetupRing(std::max(queue_depth, REQUESTS_PER_FILE), &params);
+        if (fd < 0)
+            return false;
+        ring_fd = fd;
+
+        if (!(params.features & IORING_FEAT_SINGLE_MMAP))
+            return false;
+
+        ring_size = std::max<size_t>(params.sq_off.array + params.sq_entries * sizeof(uint32_t),
+            params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+        void* const ring = mmap(nullptr, ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            ring_fd, IORING_OFF_SQ_RING);
+        if (ring == MAP_FAILED)
+            return false;
+        ring_memory = ring;
+
+        submission_entries_size = params.sq_entries * sizeof(io_uring_sqe);
+        void* const entries = mmap(nullptr, submission_entries_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            ring_fd, IORING_OFF_SQES);
+        if (entries == MAP_FAILED)
+            return false;
+        submission_entries = static_cast<io_uring_sqe*>(entries);
+
+        char* const base = static_cast<char*>(ring_memory);
+        submission_tail = reinterpret_cast<uint32_t*>(base + params.sq_off.tail);
+        submission_mask = *reinterpret_cast<uint32_t*>(base + params.sq_off.ring_mask);
+        submission_array = reinterpret_cast<uint32_t*>(base + params.sq_off.array);
+        completion_head = reinterpret_cast<uint32_t*>(base + params.cq_off.head);
+        completion_tail = reinterpret_cast<uint32_t*>(base + params.cq_off.tail);
+        completion_mask = *reinterpret_cast<uint32_t*>(base + params.cq_off.ring_mask);
+        completion_entries = reinterpret_cast<io_uring_cqe*>(base + params.cq_off.cqes);
+
+        // Every operation must be supported, older kernels would reject them at submission time
+        constexpr uint32_t PROBE_OPERATIONS = 256;
+        std::vector<char> probe_buffer(sizeof(io_uring_probe) + PROBE_OPERATIONS * sizeof(io_uring_probe_op), 0);
+        io_uring_probe* const probe = reinterpret_cast<io_uring_probe*>(probe_buffer.data());
+        if (RegisterRing(ring_fd, IORING_REGISTER_PROBE, probe, PROBE_OPERATIONS) < 0)
+            return false;
+
+        for (const uint8_t opcode : { IORING_OP_READ, IORING_OP_WRITE, IORING_OP_CLOSE })
+        {
+            if (opcode > probe->last_op || !(probe->ops[opcode].flags & IO_URING_OP_SUPPORTED))
+                return false;
+        }
+
+        files_per_group = std::min(params.sq_entries / REQUESTS_PER_FILE, MAX_FILES_PER_GROUP);
+        return true;
+    }
+
+    void IoUringCopier::Close()
+    {
+        if (submission_entries)
+            munmap(submission_entries, submission_entries_size);
+        if (ring_memory)
+            munmap(ring_memory, ring_size);
+        if (ring_fd >= 0)
+            close(ring_fd);
+
+        submission_entries = nullptr;
+        ring_memory = nullptr;
+        ring_fd = -1;
+    }
+
+
+    std::vector<bool> IoUringCopier::CopyFiles(const std::vector<std::pair<Path, Path>>& files, uint64_t& copied_bytes)
+    {
+        std::vector<bool> copied(files.size(), false);
+
+        for (size_t first = 0; first < files.size() && IsValid(); first += files_per_group)
+            CopyGroup(files, first, std::min<size_t>(files_per_group, files.size() - first), copied, copied_bytes);
+
+        return copied;
+    }
+
+    void IoUringCopier::CopyGroup(const std::vector<std::pair<Path, Path>>& files, size_t first, size_t count,
+        std::vector<bool>& copied, uint64_t& copied_bytes)
+    {
+        std::vector<FileState> states(count);
+        size_t buffer_size = 0;
+
+        // Files are opened synchronously: path lookups and file creations can block, and io_uring would hand them
+        //  over to its worker threads, which costs more than the system calls themselves when the inodes are cached
+        for (size_t i = 0; i < count; i++)
+        {
+            const char* const source = files[first + i].first.c_str();
+            const char* const destination = files[first + i].second.c_str();
+
+            const int source_fd = open(source, O_RDONLY | O_CLOEXEC);
+            if (source_fd < 0)
+                continue;
+
+            // Only copies between regular files which fit in the buffer are submitted, the others are left to the caller
+            struct stat source_stat;
+            struct stat destination_stat;
+            const bool destination_exists = lstat(destination, &destination_stat) == 0;
+            if (fstat(source_fd, &source_stat) != 0 || !S_ISREG(source_stat.st_mode) ||
+                uint64_t(source_stat.st_size) > MAX_FILE_SIZE || (destination_exists && (!S_ISREG(destination_stat.st_mode) ||
+                (destination_stat.st_dev == source_stat.st_dev && destination_stat.st_ino == source_stat.st_ino))))
+            {
+                close(source_fd);
+                continue;
+            }
+
+            const mode_t mode = source_stat.st_mode & 07777;
+            const int destination_fd = open(destination, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, mode);
+            if (destination_fd < 0)
+            {
+                close(source_fd);
+                continue;
+            }
+
+            // Like std::filesystem::copy_file(), the destination gets the permissions of the source,
+            //  which are reduced by the umask on new files and left unchanged on existing ones
+            const mode_t destination_mode = destination_exists ? (destination_stat.st_mode & 07777) : (mode & ~creation_mask);
+            if (destination_mode != mode && fchmod(destination_fd, mode) != 0)
+            {
+                close(source_fd);
+                close(destination_fd);
+                continue;
+            }
+
+            states[i] = FileState{ source_fd, destination_fd, uint64_t(source_stat.st_size) };
+            buffer_size += states[i].size;
+        }
+
+        std::vector<char> buffer(buffer_size);
+        char* file_buffer = buffer.data();
+
+        for (size_t i = 0; i < count; i++)
+        {
+            FileState& state = states[i];
+            if (state.source_fd < 0)
+                continue;
+
+            // The write starts once the read has completed in full, and both files are closed after it. A failure
+            //  (or a short read or write) cancels the rest of the chain, and the files are then closed below
+            io_uring_sqe* sqe;
+            if (state.size > 0)
+            {
+                sqe = GetSubmissionEntry(MakeUserData(i, Operation::Read));
+                sqe->opcode = IORING_OP_READ;
+                sqe->fd = state.source_fd;
+                sqe->addr = uint64_t(file_buffer);
+                sqe->len = uint32_t(state.size);
+                sqe->flags = IOSQE_IO_LINK;
+
+                sqe = GetSubmissionEntry(MakeUserData(i, Operation::Write));
+                sqe->opcode = IORING_OP_WRITE;
+                sqe->fd = state.destination_fd;
+                sqe->addr = uint64_t(file_buffer);
+                sqe->len = uint32_t(state.size);
+                sqe->flags = IOSQE_IO_LINK;
+
+                file_buffer += state.size;
+            }
+
+            sqe = GetSubmissionEntry(MakeUserData(i, Operation::CloseSource));
+            sqe->opcode = IORING_OP_CLOSE;
+            sqe->fd = state.source_fd;
+            sqe->flags = IOSQE_IO_HARDLINK;
+
+            sqe = GetSubmissionEntry(MakeUserData(i, Operation::CloseDestination));
+            sqe->opcode = IORING_OP_CLOSE;
+            sqe->fd = state.destination_fd;
+        }
+
+        SubmitAndWait([&states](uint64_t user_data, int32_t result)
+        {
+            FileState& state = states[user_data >> OPERATION_BITS];
+            const Operation operation = Operation(user_data & ((1 << OPERATION_BITS) - 1));
+
+            if (operation == Operation::CloseSource || operation == Operation::CloseDestination)
+            {
+                if (result == -ECANCELED)
+                    close(operation == Operation::CloseSource ? state.source_fd : state.destination_fd);
+                else if (result < 0 && operation == Operation::CloseDestination)
+                    state.has_failed = true;    // e.g. delayed write errors of network file systems
+            }
+            else if (result < 0 || uint64_t(result) != state.size)
+            {
+                state.has_failed = true;
+            }
+        });
+
+        for (size_t i = 0; i < count; i++)
+        {
+            const FileState& state = states[i];
+            if (state.source_fd >= 0 && !state.has_failed && IsValid())
+            {
+                copied[first + i] = true;
+                copied_bytes += state.size;
+            }
+        }
+    }
+
+
+    io_uring_sqe* IoUringCopier::GetSubmissionEntry(uint64_t user_data)
+    {
+        // The caller never queues more entries than the ring has, and waits for all of them before queueing again
+        const uint32_t index = (*submission_tail + queued_entries) & submission_mask;
+        io_uring_sqe* const sqe = &submission_entries[index];
+        std::memset(sqe, 0, sizeof(io_uring_sqe));
+        sqe->user_data = user_data;
+
+        submission_array[index] = index;
+        queued_entries++;
+        return sqe;
+    }
+
+    bool IoUringCopier::SubmitAndWait(const std::function<void(uint64_t, int32_t)>& on_completion)
+    {
+        const uint32_t count = queued_entries;
+        if (count == 0)
+            return true;
+
+        std::atomic_ref<uint32_t>(*submission_tail).store(*submission_tail + count, std::memory_order_release);
+        queued_entries = 0;
+
+        uint32_t submitted = 0;
+        uint32_t completed = 0;
+        while (completed < count)
+        {
+            const int result = EnterRing(ring_fd, count - submitted, 1, IORING_ENTER_GETEVENTS);
+            if (result < 0 && errno != EINTR)
+            {
+                // Entries may be left in the ring, so it can't be used anymore
+                Close();
+                return false;
+            }
+            if (result > 0)
+                submitted += uint32_t(result);
+
+            uint32_t head = *completion_head;
+            const uint32_t tail = std::atomic_ref<uint32_t>(*completion_tail).load(std::memory_order_acquire);
+            for (; head != tail; head++, completed++)
+            {
+                const io_uring_cqe& cqe = completion_entries[head & completion_mask];
+                on_completion(cqe.user_data, cqe.res);
+            }
+            std::atomic_ref<uint32_t>(*completion_head).store(head, std::memory_order_release);
+        }
+        return true;
+    }
+}
+#endif
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "Types.h"
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/types.h>
+
+#include <functional>
+
+
+namespace Hansel
+{
+    /* Copies batches of small files through io_uring, the asynchronous I/O interface of Linux, so that the
+        reads, writes and closings of many files are submitted with a single io_uring_enter() instead of one call each.
+       The files are opened synchronously, then each one is copied by a chain of linked requests (read of the whole
+        file, write and closing of both files), submitted together for as many files as the queue depth allows
+        (a quarter of it), up to MAX_FILES_PER_GROUP.
+       Files which are too large, which aren't regular or whose chain fails in any way are reported as not
+        copied, and must be copied with the synchronous path (see FileCopier). */
+    class IoUringCopier
+    {
+    public:
+
+        // Largest file which is copied with a single read and write (and kept in memory in the meantime)
+        static constexpr uint64_t MAX_FILE_SIZE = 1024 * 1024;
+
+        /* Limit on the files of a group, which are all open at the same time (twice this number of descriptors per
+            thread, and all the threads share the usual limit of 1024 per process), reached with a queue depth of 128 */
+        static constexpr uint32_t MAX_FILES_PER_GROUP = 32;
+
+        /* Creates the ring with the given number of submission entries, IsValid() returns false if io_uring
+            (or any of the operations which are needed) is not available. The 'creation_mask' is the umask
+            of the process, which may need to be reverted on the permissions of the destination files. */
+        IoUringCopier(uint32_t queue_depth, mode_t creation_mask);
+        ~IoUringCopier();
+
+        IoUringCopier(const IoUringCopier&) = delete;
+        IoUringCopier& operator=(const IoUringCopier&) = delete;
+
+        bool IsValid() const { return ring_fd >= 0; }
+
+        /* Copies each (source, destination) pair of files, overwriting the destination and giving it the
+            permissions of the source. Returns which files have been copied, and adds their size to 'copied_bytes'.
+           The destination of a file which hasn't been copied may have been truncated or partially written. */
+        std::vector<bool> CopyFiles(const std::vector<std::pair<Path, Path>>& files, uint64_t& copied_bytes);
+
+    private:
+
+        struct FileState;
+
+        bool Setup(uint32_t queue_depth);
+
+        void CopyGroup(const std::vector<std::pair<Path, Path>>& files, size_t first, size_t count,
+            std::vector<bool>& copied, uint64_t& copied_bytes);
+
+        io_uring_sqe* GetSubmissionEntry(uint64_t user_data);
+
+        /* Submits the queued entries and waits for all of their completions, returns false if the ring has failed
+            (in which case the descriptors of the pending requests are not closed, since they may be closed later) */
+        bool SubmitAndWait(const std::function<void(uint64_t, int32_t)>& on_completion);
+
+        void Close();
+
+        int ring_fd = -1;
+        const mode_t creation_mask;
+        uint32_t files_per_group = 0;
+
+        // Both rings are mapped together, which is supported by all the kernels with the operations used here (5.6)
+        void*  ring_memory = nullptr;
+        size_t ring_size = 0;
+        io_uring_sqe* submission_entries = nullptr;
+        size_t submission_entries_size = 0;
+
+        uint32_t* submission_tail = nullptr;
+        uint32_t  submission_mask = 0;
+        uint32_t* submission_array = nullptr;
+        uint32_t* completion_head = nullptr;
+        uint32_t* completion_tail = nullptr;
+        uint32_t  completion_mask = 0;
+        io_uring_cqe* completion_entries = nullptr;
+
+        uint32_t queued_entries = 0;
+    };
+}
+#endif
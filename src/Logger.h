@@ -19,7 +19,7 @@ namespace Hansel
 
 		template<typename... Args>
 		inline static void Trace(const std::string& fmt, Args &&...args) 
-		{ std::cout << "[TRACE] " << std::vformat(fmt, std::make_format_args(args...)) << '\n'; }
+		{ Write("[TRACE] ", std::vformat(fmt, std::make_format_args(args...))); }
 		template<typename... Args>
 		inline static void TraceVerbose(const std::string& fmt, Args &&...args) 
 		{ if (s_Verbose) Trace(fmt, std::forward<Args>(args)...); }
@@ -27,7 +27,7 @@ namespace Hansel
 #ifdef _DEBUG
 		template<typename... Args>
 		inline static void Debug(const std::string& fmt, Args &&...args)
-		{ std::cout << "[DEBUG] " << std::vformat(fmt, std::make_format_args(args...)) << '\n'; }
+		{ Write("[DEBUG] ", std::vformat(fmt, std::make_format_args(args...))); }
 #else	// Remove 'DEBUG' logs from Release builds, but keep 'TRACE' enabled since it's used by the parser
 		template<typename... Args>
 		inline static void Debug(const std::string& fmt, Args &&...args) {}
@@ -35,31 +35,35 @@ namespace Hansel
 
 		template<typename... Args>
 		inline static void Info(const std::string& fmt, Args &&...args)
-		{ std::cout << "[INFO] " << std::vformat(fmt, std::make_format_args(args...)) << '\n'; }
+		{ Write("[INFO] ", std::vformat(fmt, std::make_format_args(args...))); }
 		template<typename... Args>
 		inline static void InfoVerbose(const std::string& fmt, Args &&...args)
 		{ if (s_Verbose) Info(fmt, std::forward<Args>(args)...); }
 
 		template<typename... Args>
 		inline static void Warn(const std::string& fmt, Args &&...args)
-		{ std::cout << "[WARNING] " << std::vformat(fmt, std::make_format_args(args...)) << '\n'; }
+		{ Write("[WARNING] ", std::vformat(fmt, std::make_format_args(args...))); }
 		template<typename... Args>
 		inline static void WarnVerbose(const std::string& fmt, Args &&...args)
 		{ if (s_Verbose) Warn(fmt, std::forward<Args>(args)...); }
 
 		template<typename... Args>
 		inline static void Error(const std::string& fmt, Args &&...args)
-		{ std::cout << "[ERROR] " << std::vformat(fmt, std::make_format_args(args...)) << '\n'; }
+		{ Write("[ERROR] ", std::vformat(fmt, std::make_format_args(args...))); }
 		template<typename... Args>
 		inline static void ErrorVerbose(const std::string& fmt, Args &&...args)
 		{ if (s_Verbose) Error(fmt, std::forward<Args>(args)...); }
 
 		template<typename... Args>
 		inline static void Critical(const std::string& fmt, Args &&...args)
-		{ std::cout << "[CRITICAL] " << std::vformat(fmt, std::make_format_args(args...)) << '\n'; }
+		{ Write("[CRITICAL] ", std::vformat(fmt, std::make_format_args(args...))); }
 
 	private:
 
+		// Each message is written with a single operation, so that lines logged by different threads don't mix
+		inline static void Write(const char* tag, const std::string& message)
+		{ std::cout << (tag + message + '\n'); }
+
 		inline static bool s_Verbose = false;
 	};
 }
@@ -1,8 +1,12 @@
 #include "Parser.h"
+#include "CompiledBreadcrumbCache.h"
+#include "FileSystemCache.h"
 #include "Logger.h"
 #include "Utilities.h"
 
-#include <tinyxml2/tinyxml2.h>
+#include <algorithm>
+#include <bit>
+#include <stdexcept>
 
 
 namespace Hansel
@@ -44,75 +48,167 @@ namespace Hansel
     };
 
 
+    std::map<Parser::BreadcrumbCacheKey, std::vector<Dependency*>> Parser::BreadcrumbCache;
+    std::mutex Parser::BreadcrumbCacheMutex;
+
+    std::map<Path, std::shared_ptr<const BreadcrumbElement>> Parser::DocumentCache;
+    std::mutex Parser::DocumentCacheMutex;
+
+    std::unique_ptr<ThreadPool> Parser::ParserThreadPool;
+
+
     // Specifies the maximum breadcrumb format version that is supported by this parser
     const Hansel::Version PARSER_VERSION = { 0, 1, 0 };
 
 
+    // The settings of the first platform in a group stand for all of them, since they lead to the same attribute values
+    static size_t FirstPlatformIndex(PlatformMask mask)
+    {
+        return size_t(std::countr_zero(mask));
+    }
+
+
     std::vector<Dependency*> Parser::ParseBreadcrumb(const Path& path_to_breadcrumb, const Settings& settings)
     {
+        const std::vector<Platform> platforms = settings.platforms.empty() ? std::vector<Platform>{ settings.platform } : settings.platforms;
+
+        // Each target platform is parsed with its own context, which only differ by the platform-specific variables
+        PlatformVariants variants{ 0, {} };
+        for (size_t index = 0; index < platforms.size(); index++)
+        {
+            Environment platform_variables = settings.variables;
+            if (platform_variables.contains("OUTPUT_DIR"))
+                platform_variables["OUTPUT_DIR"] = Utilities::CombinePath(settings.output, platforms[index].ToString());
+            if (platform_variables.contains("PLATFORM_DIR"))
+                platform_variables["PLATFORM_DIR"] = platforms[index].ToString();
+
+            variants.contexts.push_back(ParseContext
+            {
+                &settings,
+                platforms[index],
+                settings.target,
+                std::make_shared<const ScopedEnvironment>(std::move(platform_variables))
+            });
+            variants.mask |= PlatformMask(1) << index;
+        }
+
+        return ParseBreadcrumb(path_to_breadcrumb, variants);
+    }
+
+    std::vector<Dependency*> Parser::ParseBreadcrumb(const Path& path_to_breadcrumb, const PlatformVariants& variants)
+    {
+        const ParseContext& context = variants.contexts[FirstPlatformIndex(variants.mask)];
+
         // Check if file exists
-        if (!std::filesystem::exists(path_to_breadcrumb))
+        if (!FileSystemCache::Exists(path_to_breadcrumb))
         {
-            throw std::exception(("No breadcrumb file found at '" + path_to_breadcrumb + "'").c_str());
+            throw std::runtime_error(("No breadcrumb file found at '" + path_to_breadcrumb + "'").c_str());
         }
 
-        // Load breadcrumb file and parse XML document
-        tinyxml2::XMLDocument document;
-        document.LoadFile(path_to_breadcrumb.c_str());
+        // Create the pool used for parsing sibling sub-trees concurrently (the calling thread also takes part in the work)
+        if (context.settings->jobs > 1 && !ParserThreadPool)
+            ParserThreadPool = std::make_unique<ThreadPool>(context.settings->jobs - 1);
 
-        // Check XML parsing errors
-        if (document.Error())
+        // Libraries are usually required by many different modules, re-use the dependency sub-tree if this
+        //  breadcrumb has already been parsed with the same settings (the tree effectively becomes a DAG)
+        BreadcrumbCacheKey cache_key{ FileSystemCache::Canonical(path_to_breadcrumb), variants.mask, {} };
+        for (size_t index = 0; index < variants.contexts.size(); index++)
         {
-            throw std::exception(document.ErrorStr());
+            if ((variants.mask & (PlatformMask(1) << index)) != 0)
+                cache_key.variables.push_back(*variants.contexts[index].variables);
         }
 
+        {
+            std::lock_guard<std::mutex> lock(BreadcrumbCacheMutex);
+
+            const auto cache_it = BreadcrumbCache.find(cache_key);
+            if (cache_it != BreadcrumbCache.end())
+            {
+                Logger::TraceVerbose("Re-using parsed breadcrumb: '{}'", path_to_breadcrumb);
+                return cache_it->second;
+            }
+        }
+
+        // NOTE: a breadcrumb which is still being parsed by another thread is not waited for (tasks only ever wait
+        //  for their own sub-trees, which keeps the thread pool free of deadlocks), it's parsed again instead and
+        //  the first result that reaches the cache is the one shared by all references
+        const std::vector<Dependency*> dependencies = ParseBreadcrumbDocument(path_to_breadcrumb, cache_key.path, variants);
+
+        std::lock_guard<std::mutex> lock(BreadcrumbCacheMutex);
+        return BreadcrumbCache.try_emplace(std::move(cache_key), dependencies).first->second;
+    }
+
+
+    std::shared_ptr<const BreadcrumbElement> Parser::LoadBreadcrumbDocument(const Path& path_to_breadcrumb,
+        const Path& canonical_path, const ParseContext& context)
+    {
+        {
+            std::lock_guard<std::mutex> lock(DocumentCacheMutex);
+
+            const auto cache_it = DocumentCache.find(canonical_path);
+            if (cache_it != DocumentCache.end())
+                return cache_it->second;
+        }
+
+        // Load the breadcrumb element tree, directly from its compiled form if the cache is enabled and up-to-date
+        BreadcrumbElement breadcrumb = context.settings->cache_dir.empty()
+            ? BreadcrumbElement::LoadFromFile(path_to_breadcrumb)
+            : CompiledBreadcrumbCache::Load(path_to_breadcrumb, context.settings->cache_dir, PARSER_VERSION);
+
+        // Conditions of <Restrict> nodes are compiled once, then the document is only evaluated (never modified)
+        CompileRestrictNodes(breadcrumb);
+
+        auto document = std::make_shared<const BreadcrumbElement>(std::move(breadcrumb));
+
+        std::lock_guard<std::mutex> lock(DocumentCacheMutex);
+        return DocumentCache.try_emplace(canonical_path, std::move(document)).first->second;
+    }
+
+    std::vector<Dependency*> Parser::ParseBreadcrumbDocument(const Path& path_to_breadcrumb, const Path& canonical_path,
+        const PlatformVariants& variants)
+    {
+        const ParseContext& context = variants.contexts[FirstPlatformIndex(variants.mask)];
+
+        // The same breadcrumb is loaded only once, even when reached with different settings (e.g. the same library
+        //  with a different destination), since <Restrict> evaluation doesn't modify the shared element tree
+        const std::shared_ptr<const BreadcrumbElement> document = LoadBreadcrumbDocument(path_to_breadcrumb, canonical_path, context);
+
         // Log the path of the current file being parsed, to provide context for understanding error messages
         Logger::Trace("Parsing breadcrumb: '{}'", path_to_breadcrumb);
 
         // Access the top-level <Breadcrumb> node
-        tinyxml2::XMLElement* breadcrumb_element = document.FirstChildElement("Breadcrumb");
-        if (!breadcrumb_element)
-        {
-            throw std::exception("Invalid breadcrumb file (no top-level <Breadcrumb> element)");
-        }
+        const BreadcrumbElement* breadcrumb_element = document.get();
 
         const std::optional<Version> breadcrumb_version = GetAttributeAsVersion(breadcrumb_element, "FormatVersion");
         if (!breadcrumb_version.has_value())
         {
-            throw std::exception("Invalid breadcrumb file (missing 'FormatVersion' attribute)");
+            throw std::runtime_error("Invalid breadcrumb file (missing 'FormatVersion' attribute)");
         }
         if (breadcrumb_version.value() > PARSER_VERSION)
         {
-            throw std::exception(("The breadcrumb file format version " + breadcrumb_version.value().ToString() 
+            throw std::runtime_error(("The breadcrumb file format version " + breadcrumb_version.value().ToString() 
                 + " is not supported by this version of Hansel").c_str());
         }
 
 
-        // Search for all <Restrict> nodes in the document and evaluate them
-        ProcessChildrenRestrictNodes(breadcrumb_element, settings);
-
-
         std::vector<Dependency*> dependencies;
 
         // Iterate through children of the <Breadcrumb> node looking for <Dependencies> elements to parse
         // NOTE: multiple <Dependencies> nodes are supported (and their contents merged together)
-        const tinyxml2::XMLElement* element = breadcrumb_element->FirstChildElement();
-        while (element != nullptr)
+        ForEachEnabledChild(breadcrumb_element, variants, variants.mask, [&](const BreadcrumbElement* element, PlatformMask mask)
         {
-            const std::string element_name = element->Name();
+            const std::string& element_name = element->name;
 
             if (element_name == "Dependencies")
             {
-                const std::vector<Dependency*> some_dependencies = ParseDependencies(element, settings);
+                const std::vector<Dependency*> some_dependencies = ParseDependencies(element, variants, mask);
                 dependencies.insert(dependencies.end(), some_dependencies.begin(), some_dependencies.end());
             }
             else
             {
-                throw std::exception(("Element of type <" + element_name + "> is not supported at this location").c_str());
+                throw std::runtime_error(("Element of type <" + element_name + "> is not supported at this location").c_str());
             }
-
-            element = element->NextSiblingElement();
-        }
+        });
 
         if (dependencies.empty())
         {
@@ -123,134 +219,167 @@ namespace Hansel
     }
 
 
-    std::vector<Dependency*> Parser::ParseDependencies(const tinyxml2::XMLElement* dependencies_element, const Settings& settings)
+    std::vector<Dependency*> Parser::ParseDependencies(const BreadcrumbElement* dependencies_element,
+        const PlatformVariants& variants, PlatformMask mask)
     {
         std::vector<Dependency*> dependencies;
 
-        // Parse <ProjectPath>, <LibraryPath> and <ScriptPath> attributes
-        const std::optional<std::string> project_path_attribute = GetAttributeAsSubstitutedString(dependencies_element, "ProjectPath", settings.variables);
-        const std::optional<std::string> library_path_attribute = GetAttributeAsSubstitutedString(dependencies_element, "LibraryPath", settings.variables);
-        const std::optional<std::string> script_path_attribute  = GetAttributeAsSubstitutedString(dependencies_element, "ScriptPath",  settings.variables);
-
-        std::vector<std::string> project_root_paths;
-        if (project_path_attribute.has_value())
+        // Parses a ';'-separated list of lookup paths, to which the current target directory path is appended
+        //  as the last (lower priority) lookup path
+        const auto parse_root_paths = [dependencies_element](const char* attribute, const ParseContext& context)
         {
-            project_root_paths = Utilities::SplitString(project_path_attribute.value(), ';');
-            for (size_t i = 0; i < project_root_paths.size(); i++)
-            {
-                project_root_paths[i] = Utilities::TrimString(project_root_paths[i]);
-                if (Utilities::IsRelativePath(project_root_paths[i]))
-                    project_root_paths[i] = Utilities::CombinePath(settings.GetTargetDirectoryPath(), project_root_paths[i]);
-            }
-        }
-        // Append the current target directory path as the last (lower priority) project lookup path
-        project_root_paths.push_back(settings.GetTargetDirectoryPath());
+            const std::optional<std::string> root_paths_attribute = GetAttributeAsSubstitutedString(dependencies_element, attribute, *context.variables);
 
-        std::vector<std::string> library_root_paths;
-        if (library_path_attribute.has_value())
-        {
-            library_root_paths = Utilities::SplitString(library_path_attribute.value(), ';');
-            for (size_t i = 0; i < library_root_paths.size(); i++)
+            std::vector<std::string> root_paths;
+            if (root_paths_attribute.has_value())
             {
-                library_root_paths[i] = Utilities::TrimString(library_root_paths[i]);
-                if (Utilities::IsRelativePath(library_root_paths[i]))
-                    library_root_paths[i] = Utilities::CombinePath(settings.GetTargetDirectoryPath(), library_root_paths[i]);
+                root_paths = Utilities::SplitString(root_paths_attribute.value(), ';');
+                for (size_t i = 0; i < root_paths.size(); i++)
+                {
+                    root_paths[i] = Utilities::TrimString(root_paths[i]);
+                    if (Utilities::IsRelativePath(root_paths[i]))
+                        root_paths[i] = Utilities::CombinePath(context.GetTargetDirectoryPath(), root_paths[i]);
+                }
             }
-        }
-        // Append the current target directory path as the last (lower priority) library lookup path
-        library_root_paths.push_back(settings.GetTargetDirectoryPath());
-
-        std::vector<std::string> script_root_paths;
-        if (script_path_attribute.has_value())
+            root_paths.push_back(context.GetTargetDirectoryPath());
+            return root_paths;
+        };
+
+        // Parse <ProjectPath>, <LibraryPath> and <ScriptPath> attributes (for each platform, as they may contain platform-specific variables)
+        const size_t platform_count = variants.contexts.size();
+        std::vector<std::vector<std::string>> project_root_paths(platform_count);
+        std::vector<std::vector<std::string>> library_root_paths(platform_count);
+        std::vector<std::vector<std::string>> script_root_paths(platform_count);
+        std::vector<std::vector<std::string>> all_root_paths(platform_count);
+
+        for (size_t index = 0; index < platform_count; index++)
         {
-            script_root_paths = Utilities::SplitString(script_path_attribute.value(), ';');
-            for (size_t i = 0; i < script_root_paths.size(); i++)
-            {
-                script_root_paths[i] = Utilities::TrimString(script_root_paths[i]);
-                if (Utilities::IsRelativePath(script_root_paths[i]))
-                    script_root_paths[i] = Utilities::CombinePath(settings.GetTargetDirectoryPath(), script_root_paths[i]);
-            }
+            if ((mask & (PlatformMask(1) << index)) == 0)
+                continue;
+
+            const ParseContext& context = variants.contexts[index];
+            project_root_paths[index] = parse_root_paths("ProjectPath", context);
+            library_root_paths[index] = parse_root_paths("LibraryPath", context);
+            script_root_paths[index]  = parse_root_paths("ScriptPath",  context);
+
+            all_root_paths[index] = project_root_paths[index];
+            all_root_paths[index].insert(all_root_paths[index].end(), library_root_paths[index].begin(), library_root_paths[index].end());
+            all_root_paths[index].insert(all_root_paths[index].end(), script_root_paths[index].begin(), script_root_paths[index].end());
         }
-        // Append the current target directory path as the last (lower priority) script lookup path
-        script_root_paths.push_back(settings.GetTargetDirectoryPath());
 
 
-        // Iterate over all <Dependencies> children elements and parse them accordingly
-        const tinyxml2::XMLElement* element = dependencies_element->FirstChildElement();
-        while (element != nullptr)
+        // Parses a single dependency element for a group of platforms (a <Project> or <Library> element parses its entire sub-tree)
+        const auto parse_element = [&](const BreadcrumbElement* element, PlatformMask group_mask) -> Dependency*
         {
-            if (!element->NoChildren())
-                throw std::exception("Dependency specifier elements must not have any children");
+            bool has_children = element->has_other_children;
+            ForEachEnabledChild(element, variants, group_mask, [&has_children](const BreadcrumbElement*, PlatformMask) { has_children = true; });
+            if (has_children)
+                throw std::runtime_error("Dependency specifier elements must not have any children");
 
-            const std::string element_name = element->Name();
+            const size_t index = FirstPlatformIndex(group_mask);
+            const ParseContext& context = variants.contexts[index];
 
+            const std::string& element_name = element->name;
+
+            Dependency* dependency = nullptr;
             if (element_name == "Project")
-            {
-                dependencies.push_back(ParseProjectDependency(element, settings, project_root_paths));
-            }
+                dependency = ParseProjectDependency(element, variants, group_mask, project_root_paths[index]);
             else if (element_name == "Library")
-            {
-                dependencies.push_back(ParseLibraryDependency(element, settings, library_root_paths));
-            }
+                dependency = ParseLibraryDependency(element, variants, group_mask, library_root_paths[index]);
             else if (element_name == "File")
-            {
-                dependencies.push_back(ParseFileDependency(element, settings));
-            }
+                dependency = ParseFileDependency(element, context);
             else if (element_name == "Files")
-            {
-                dependencies.push_back(ParseFilesDependency(element, settings));
-            }
+                dependency = ParseFilesDependency(element, context);
             else if (element_name == "Directory")
-            {
-                dependencies.push_back(ParseDirectoryDependency(element, settings));
-            }
+                dependency = ParseDirectoryDependency(element, context);
             else if (element_name == "Command")
+                dependency = ParseCommandDependency(element, context);
+            else if (element_name == "Script")
+                dependency = ParseScriptDependency(element, context, script_root_paths[index]);
+            else
+                throw std::runtime_error(("Element of type <" + element_name + "> is not supported at this location").c_str());
+
+            dependency->SetPlatforms(group_mask);
+            return dependency;
+        };
+
+        // Iterate over all <Dependencies> children elements and parse them accordingly
+        // NOTE: when parsing with multiple jobs, the sub-trees of <Project> and <Library> elements are handed over
+        //  to the thread pool, all other elements are parsed immediately but their errors are deferred as well
+        std::vector<std::future<Dependency*>> results;
+
+        // <Restrict> conditions are all evaluated before handing out any work, so that no task is left running on error
+        // NOTE: with multiple platforms, an element produces one dependency for each group of platforms that share
+        //  the same attribute values (a single one, unless the attributes contain platform-specific variables)
+        std::vector<std::pair<const BreadcrumbElement*, PlatformMask>> elements;
+        ForEachEnabledChild(dependencies_element, variants, mask, [&](const BreadcrumbElement* element, PlatformMask element_mask)
+        {
+            const std::vector<PlatformMask> groups = (std::popcount(element_mask) == 1)
+                ? std::vector<PlatformMask>{ element_mask }
+                : GroupPlatformVariants(element, variants, element_mask, all_root_paths);
+
+            for (const PlatformMask group_mask : groups)
+                elements.emplace_back(element, group_mask);
+        });
+
+        for (const auto& [element, group_mask] : elements)
+        {
+            if (!ParserThreadPool)
             {
-                dependencies.push_back(ParseCommandDependency(element, settings));
+                dependencies.push_back(parse_element(element, group_mask));
             }
-            else if (element_name == "Script")
+            else if (element->name == "Project" || element->name == "Library")
             {
-                dependencies.push_back(ParseScriptDependency(element, settings, script_root_paths));
+                results.push_back(ParserThreadPool->Submit([&parse_element, element, group_mask]() { return parse_element(element, group_mask); }));
             }
             else
             {
-                throw std::exception(("Element of type <" + element_name + "> is not supported at this location").c_str());
+                std::packaged_task<Dependency*()> task([&parse_element, element, group_mask]() { return parse_element(element, group_mask); });
+                results.push_back(task.get_future());
+                task();
             }
-
-            element = element->NextSiblingElement();
         }
 
+        // Wait for all sub-trees to be completed (they reference this document), then collect the results in
+        //  document order so that the reported error is the same that the serial parser would have encountered first
+        for (const std::future<Dependency*>& result : results)
+            ParserThreadPool->Wait(result);
+        for (std::future<Dependency*>& result : results)
+            dependencies.push_back(result.get());
+
         return dependencies;
     }
 
 
-    ProjectDependency* Parser::ParseProjectDependency(const tinyxml2::XMLElement* project_element,
-        const Settings& settings, const std::vector<std::string>& project_root_paths)
+    ProjectDependency* Parser::ParseProjectDependency(const BreadcrumbElement* project_element,
+        const PlatformVariants& variants, PlatformMask mask, const std::vector<std::string>& project_root_paths)
     {
-        const std::optional<std::string> name = GetAttributeAsSubstitutedString(project_element, "Name", settings.variables);
+        const ParseContext& context = variants.contexts[FirstPlatformIndex(mask)];
+
+        const std::optional<std::string> name = GetAttributeAsSubstitutedString(project_element, "Name", *context.variables);
         if (!name.has_value())
-            throw std::exception("Invalid <Project> node (missing 'Name' attribute)");
+            throw std::runtime_error("Invalid <Project> node (missing 'Name' attribute)");
 
-        const std::optional<Path> path = GetAttributeAsPath(project_element, "Path", settings.variables);
+        const std::optional<Path> path = GetAttributeAsPath(project_element, "Path", *context.variables);
 
-        const std::optional<Path> destination = GetAttributeAsPath(project_element, "Destination", settings.variables);
+        const std::optional<Path> destination = GetAttributeAsPath(project_element, "Destination", *context.variables);
         if (!destination.has_value())
-            throw std::exception("Invalid <Project> node (missing 'Destination' attribute)");
+            throw std::runtime_error("Invalid <Project> node (missing 'Destination' attribute)");
 
         if (!CheckDestinationAttribute(project_element))
-            throw std::exception("Invalid <Project> node (the 'Destination' attribute value must always begin with '$(OUTPUT_DIR)')");
+            throw std::runtime_error("Invalid <Project> node (the 'Destination' attribute value must always begin with '$(OUTPUT_DIR)')");
 
         // Resolve project directory using the Path attribute (if specified) or the value of the Name attribute
         Path project_directory_path;
         if (path.has_value())
         {
-            project_directory_path = Utilities::MakeAbsolutePath(path.value(), settings.GetTargetDirectoryPath());
+            project_directory_path = Utilities::MakeAbsolutePath(path.value(), context.GetTargetDirectoryPath());
         }
         else
         {
             const std::optional<Path> resolved_path = Utilities::ResolvePath(name.value(), project_root_paths);
             if (!resolved_path.has_value())
-                throw std::exception(("Couldn't resolve '" + name.value() + "' project directory").c_str());
+                throw std::runtime_error(("Couldn't resolve '" + name.value() + "' project directory").c_str());
 
             project_directory_path = resolved_path.value();
         }
@@ -258,16 +387,29 @@ namespace Hansel
         // Derive the path of the target breadcrumb
         const Path project_breadcrumb_path = Utilities::CombinePath(project_directory_path, name.value() + ".hbc");
 
-        // Recursively parse the target breadcrumb with updated settings
-        Settings parser_settings = settings;
-        parser_settings.target = project_breadcrumb_path;
-        parser_settings.variables["OUTPUT_DIR"] = destination.value();
+        // Recursively parse the target breadcrumb with updated context (for each platform of the group), where
+        //  the nested scope of variables only overrides OUTPUT_DIR instead of copying all of them
+        PlatformVariants parser_variants{ mask, std::vector<ParseContext>(variants.contexts.size()) };
+        for (size_t index = 0; index < variants.contexts.size(); index++)
+        {
+            if ((mask & (PlatformMask(1) << index)) == 0)
+                continue;
+
+            const ParseContext& platform_context = variants.contexts[index];
+            parser_variants.contexts[index] = ParseContext
+            {
+                platform_context.settings,
+                platform_context.platform,
+                project_breadcrumb_path,
+                std::make_shared<const ScopedEnvironment>(platform_context.variables, Environment{ { "OUTPUT_DIR", destination.value() } })
+            };
+        }
 
-        const std::vector<Dependency*> project_dependencies = ParseBreadcrumb(project_breadcrumb_path, parser_settings);
+        const std::vector<Dependency*> project_dependencies = ParseBreadcrumb(project_breadcrumb_path, parser_variants);
 
         return new ProjectDependency
         (
-            settings.target,
+            context.target,
             name.value(),
             project_directory_path,
             destination.value(),
@@ -275,37 +417,39 @@ namespace Hansel
         );
     }
 
-    LibraryDependency* Parser::ParseLibraryDependency(const tinyxml2::XMLElement* library_element,
-        const Settings& settings, const std::vector<std::string>& library_root_paths)
+    LibraryDependency* Parser::ParseLibraryDependency(const BreadcrumbElement* library_element,
+        const PlatformVariants& variants, PlatformMask mask, const std::vector<std::string>& library_root_paths)
     {
-        const std::optional<std::string> name = GetAttributeAsSubstitutedString(library_element, "Name", settings.variables);
+        const ParseContext& context = variants.contexts[FirstPlatformIndex(mask)];
+
+        const std::optional<std::string> name = GetAttributeAsSubstitutedString(library_element, "Name", *context.variables);
         if (!name.has_value())
-            throw std::exception("Invalid <Library> node (missing 'Name' attribute)");
+            throw std::runtime_error("Invalid <Library> node (missing 'Name' attribute)");
 
         const std::optional<Version> version = GetAttributeAsVersion(library_element, "Version");
         if (!version.has_value())
-            throw std::exception("Invalid <Library> node (missing 'Version' attribute)");
+            throw std::runtime_error("Invalid <Library> node (missing 'Version' attribute)");
 
-        const std::optional<Path> path = GetAttributeAsPath(library_element, "Path", settings.variables);
+        const std::optional<Path> path = GetAttributeAsPath(library_element, "Path", *context.variables);
 
-        const std::optional<Path> destination = GetAttributeAsPath(library_element, "Destination", settings.variables);
+        const std::optional<Path> destination = GetAttributeAsPath(library_element, "Destination", *context.variables);
         if (!destination.has_value())
-            throw std::exception("Invalid <Library> node (missing 'Destination' attribute)");
+            throw std::runtime_error("Invalid <Library> node (missing 'Destination' attribute)");
 
         if (!CheckDestinationAttribute(library_element))
-            throw std::exception("Invalid <Library> node (the 'Destination' attribute value must always begin with '$(OUTPUT_DIR)')");
+            throw std::runtime_error("Invalid <Library> node (the 'Destination' attribute value must always begin with '$(OUTPUT_DIR)')");
 
         // Resolve library directory using the Path attribute (if specified) or the values of the Name/Version attributes
         Path library_directory_path;
         if (path.has_value())
         {
-            library_directory_path = Utilities::MakeAbsolutePath(path.value(), settings.GetTargetDirectoryPath());
+            library_directory_path = Utilities::MakeAbsolutePath(path.value(), context.GetTargetDirectoryPath());
         }
         else
         {
             const std::optional<Path> resolved_path = Utilities::ResolvePath(name.value() + "/" + version.value().ToString(), library_root_paths);
             if (!resolved_path.has_value())
-                throw std::exception(("Couldn't resolve '" + name.value() + "(" + version.value().ToString() + ")' library directory").c_str());
+                throw std::runtime_error(("Couldn't resolve '" + name.value() + "(" + version.value().ToString() + ")' library directory").c_str());
 
             library_directory_path = resolved_path.value();
         }
@@ -313,16 +457,29 @@ namespace Hansel
         // Derive the path of the target breadcrumb
         const Path library_breadcrumb_path = Utilities::CombinePath(library_directory_path, name.value() + ".hbc");
 
-        // Recursively parse the target breadcrumb with updated settings
-        Settings parser_settings = settings;
-        parser_settings.target = library_breadcrumb_path;
-        parser_settings.variables["OUTPUT_DIR"] = destination.value();
+        // Recursively parse the target breadcrumb with updated context (for each platform of the group), where
+        //  the nested scope of variables only overrides OUTPUT_DIR instead of copying all of them
+        PlatformVariants parser_variants{ mask, std::vector<ParseContext>(variants.contexts.size()) };
+        for (size_t index = 0; index < variants.contexts.size(); index++)
+        {
+            if ((mask & (PlatformMask(1) << index)) == 0)
+                continue;
+
+            const ParseContext& platform_context = variants.contexts[index];
+            parser_variants.contexts[index] = ParseContext
+            {
+                platform_context.settings,
+                platform_context.platform,
+                library_breadcrumb_path,
+                std::make_shared<const ScopedEnvironment>(platform_context.variables, Environment{ { "OUTPUT_DIR", destination.value() } })
+            };
+        }
 
-        const std::vector<Dependency*> library_dependencies = ParseBreadcrumb(library_breadcrumb_path, parser_settings);
+        const std::vector<Dependency*> library_dependencies = ParseBreadcrumb(library_breadcrumb_path, parser_variants);
 
         return new LibraryDependency
         (
-            settings.target,
+            context.target,
             name.value(),
             version.value(),
             library_directory_path,
@@ -331,106 +488,108 @@ namespace Hansel
         );
     }
 
-    FileDependency* Parser::ParseFileDependency(const tinyxml2::XMLElement* file_element,
-        const Settings& settings)
+    FileDependency* Parser::ParseFileDependency(const BreadcrumbElement* file_element,
+        const ParseContext& context)
     {
-        const std::optional<Path> path = GetAttributeAsPath(file_element, "Path", settings.variables);
+        const std::optional<Path> path = GetAttributeAsPath(file_element, "Path", *context.variables);
         if (!path.has_value())
-            throw std::exception("Invalid <File> node (missing 'Path' attribute)");
+            throw std::runtime_error("Invalid <File> node (missing 'Path' attribute)");
 
-        const std::optional<Path> destination = GetAttributeAsPath(file_element, "Destination", settings.variables);
+        const std::optional<Path> destination = GetAttributeAsPath(file_element, "Destination", *context.variables);
         if (!destination.has_value())
-            throw std::exception("Invalid <File> node (missing 'Destination' attribute)");
+            throw std::runtime_error("Invalid <File> node (missing 'Destination' attribute)");
 
         if (!CheckDestinationAttribute(file_element))
-            throw std::exception("Invalid <File> node (the 'Destination' attribute value must always begin with '$(OUTPUT_DIR)')");
+            throw std::runtime_error("Invalid <File> node (the 'Destination' attribute value must always begin with '$(OUTPUT_DIR)')");
 
         // Extract the "full" path to the dependency file
-        const Path complete_file_path = Utilities::MakeAbsolutePath(path.value(), settings.GetTargetDirectoryPath());
+        const Path complete_file_path = Utilities::MakeAbsolutePath(path.value(), context.GetTargetDirectoryPath());
 
         return new FileDependency
         (
-            settings.target,
+            context.target,
             complete_file_path,
             destination.value()
         );
     }
 
-    FilesDependency* Parser::ParseFilesDependency(const tinyxml2::XMLElement* files_element,
-        const Settings& settings)
+    FilesDependency* Parser::ParseFilesDependency(const BreadcrumbElement* files_element,
+        const ParseContext& context)
     {
-        const std::optional<Path> path = GetAttributeAsPath(files_element, "Path", settings.variables);
+        const std::optional<Path> path = GetAttributeAsPath(files_element, "Path", *context.variables);
         if (!path.has_value())
-            throw std::exception("Invalid <Files> node (missing 'Path' attribute)");
+            throw std::runtime_error("Invalid <Files> node (missing 'Path' attribute)");
 
-        const std::optional<Path> destination = GetAttributeAsPath(files_element, "Destination", settings.variables);
+        const std::optional<Path> destination = GetAttributeAsPath(files_element, "Destination", *context.variables);
         if (!destination.has_value())
-            throw std::exception("Invalid <Files> node (missing 'Destination' attribute)");
+            throw std::runtime_error("Invalid <Files> node (missing 'Destination' attribute)");
 
         if (!CheckDestinationAttribute(files_element))
-            throw std::exception("Invalid <Files> node (the 'Destination' attribute value must always begin with '$(OUTPUT_DIR)')");
+            throw std::runtime_error("Invalid <Files> node (the 'Destination' attribute value must always begin with '$(OUTPUT_DIR)')");
 
         // Extract the "full" path to the dependency files
-        const Path complete_files_path = Utilities::MakeAbsolutePath(path.value(), settings.GetTargetDirectoryPath());
+        const Path complete_files_path = Utilities::MakeAbsolutePath(path.value(), context.GetTargetDirectoryPath());
 
         return new FilesDependency
         (
-            settings.target,
+            context.target,
             complete_files_path,
             destination.value()
         );
     }
 
-    DirectoryDependency* Parser::ParseDirectoryDependency(const tinyxml2::XMLElement* directory_element,
-        const Settings& settings)
+    DirectoryDependency* Parser::ParseDirectoryDependency(const BreadcrumbElement* directory_element,
+        const ParseContext& context)
     {
-        const std::optional<Path> path = GetAttributeAsPath(directory_element, "Path", settings.variables);
+        const std::optional<Path> path = GetAttributeAsPath(directory_element, "Path", *context.variables);
         if (!path.has_value())
-            throw std::exception("Invalid <Directory> node (missing 'Path' attribute)");
+            throw std::runtime_error("Invalid <Directory> node (missing 'Path' attribute)");
 
-        const std::optional<Path> destination = GetAttributeAsPath(directory_element, "Destination", settings.variables);
+        const std::optional<Path> destination = GetAttributeAsPath(directory_element, "Destination", *context.variables);
         if (!destination.has_value())
-            throw std::exception("Invalid <Directory> node (missing 'Destination' attribute)");
+            throw std::runtime_error("Invalid <Directory> node (missing 'Destination' attribute)");
 
         if (!CheckDestinationAttribute(directory_element))
-            throw std::exception("Invalid <Directory> node (the 'Destination' attribute value must always begin with '$(OUTPUT_DIR)')");
+            throw std::runtime_error("Invalid <Directory> node (the 'Destination' attribute value must always begin with '$(OUTPUT_DIR)')");
 
         // Extract the "full" path to the dependency directory
-        const Path complete_directory_path = Utilities::MakeAbsolutePath(path.value(), settings.GetTargetDirectoryPath());
+        const Path complete_directory_path = Utilities::MakeAbsolutePath(path.value(), context.GetTargetDirectoryPath());
 
         return new DirectoryDependency
         (
-            settings.target,
+            context.target,
             complete_directory_path,
             destination.value()
         );
     }
 
-    CommandDependency* Parser::ParseCommandDependency(const tinyxml2::XMLElement* command_element, const Settings& settings)
+    CommandDependency* Parser::ParseCommandDependency(const BreadcrumbElement* command_element, const ParseContext& context)
     {
-        const std::optional<std::string> code = GetAttributeAsSubstitutedString(command_element, "Code", settings.variables);
+        const std::optional<std::string> code = GetAttributeAsSubstitutedString(command_element, "Code", *context.variables);
 
         return new CommandDependency
         (
-            settings.target,
-            code.value()
+            context.target,
+            code.value(),
+            GetAttributeAsPathList(command_element, "Inputs", context),
+            GetAttributeAsPathList(command_element, "Outputs", context)
         );
     }
 
-    ScriptDependency* Parser::ParseScriptDependency(const tinyxml2::XMLElement* script_element,
-        const Settings& settings, const std::vector<std::string>& script_root_paths)
+    ScriptDependency* Parser::ParseScriptDependency(const BreadcrumbElement* script_element,
+        const ParseContext& context, const std::vector<std::string>& script_root_paths)
     {
-        const std::optional<std::string> interpreter = GetAttributeAsSubstitutedString(script_element, "Interpreter", settings.variables);
+        const std::optional<std::string> interpreter = GetAttributeAsSubstitutedString(script_element, "Interpreter", *context.variables);
 
-        const std::optional<std::string> name = GetAttributeAsSubstitutedString(script_element, "Name", settings.variables);
+        const std::optional<std::string> name = GetAttributeAsSubstitutedString(script_element, "Name", *context.variables);
 
-        const std::optional<Path> path = GetAttributeAsPath(script_element, "Path", settings.variables);
+        const std::optional<Path> path = GetAttributeAsPath(script_element, "Path", *context.variables);
         if (!name.has_value() && !path.has_value())
-            throw std::exception("Invalid <Script> node (missing atleast one of 'Name' or 'Path' attributes)");
+            throw std::runtime_error("Invalid <Script> node (missing atleast one of 'Name' or 'Path' attributes)");
 
-        const std::optional<std::string> arguments = GetAttributeAsSubstitutedString(script_element, "Arguments", settings.variables);
+        const std::optional<std::string> arguments = GetAttributeAsSubstitutedString(script_element, "Arguments", *context.variables);
         if (!arguments.has_value())
-            throw std::exception("Invalid <Script> node (missing 'Arguments' attribute)");
+            throw std::runtime_error("Invalid <Script> node (missing 'Arguments' attribute)");
 
         // Derive script filename from Name or Path attributes
         const std::string filename = (name.has_value() && !path.has_value())
@@ -441,90 +600,110 @@ namespace Hansel
         std::optional<Path> interpreter_path;
         if (interpreter.has_value() && Utilities::IsRelativePath(interpreter.value()))
         {
-            interpreter_path = Utilities::CombinePath(settings.GetTargetDirectoryPath(), interpreter.value());
+            interpreter_path = Utilities::CombinePath(context.GetTargetDirectoryPath(), interpreter.value());
         }
 
         // Resolve script path using the Path attribute (if specified) or the value of the Name attribute
         Path script_path;
         if (path.has_value())
         {
-            script_path = Utilities::MakeAbsolutePath(path.value(), settings.GetTargetDirectoryPath());
+            script_path = Utilities::MakeAbsolutePath(path.value(), context.GetTargetDirectoryPath());
         }
         else
         {
             const std::optional<Path> resolved_path = Utilities::ResolvePath(name.value(), script_root_paths);
             if (!resolved_path.has_value())
-                throw std::exception(("Couldn't resolve '" + name.value() + "' script path").c_str());
+                throw std::runtime_error(("Couldn't resolve '" + name.value() + "' script path").c_str());
 
             script_path = resolved_path.value();
         }
 
         return new ScriptDependency
         (
-            settings.target,
+            context.target,
             interpreter_path.value_or(Path{}),
             name.value_or(filename),
             script_path,
-            arguments.value()
+            arguments.value(),
+            GetAttributeAsPathList(script_element, "Inputs", context),
+            GetAttributeAsPathList(script_element, "Outputs", context)
         );
     }
 
 
-    void Parser::ProcessChildrenRestrictNodes(tinyxml2::XMLNode* root, const Settings& settings)
+    template<typename Visitor>
+    void Parser::ForEachEnabledChild(const BreadcrumbElement* element, const PlatformVariants& variants, PlatformMask mask, Visitor&& visitor)
     {
-        if (!root || root->NoChildren())
-            return;
-
-        // Iterate over all children nodes to find <Restrict> elements
-        tinyxml2::XMLNode* node = root->FirstChild();
-        while (node != nullptr)
+        for (const BreadcrumbElement& child_element : element->children)
         {
-            tinyxml2::XMLElement* element = node->ToElement();
-            if (element)
+            if (child_element.name != "Restrict")
             {
-                const std::string element_name = element->Name();
+                visitor(&child_element, mask);
+            }
+            else if (child_element.NoChildren())
+            {
+                // The element is left in place, where it's reported as not supported
+                Logger::Warn("The <Restrict> node at {} (line {}) has no children and will be skipped",
+                    variants.contexts[FirstPlatformIndex(mask)].GetTargetBreadcrumbFilename(), child_element.line);
+                visitor(&child_element, mask);
+            }
+            else
+            {
+                // Children of a satisfied <Restrict> node take its place, disabled blocks are skipped entirely
+                const PlatformMask enabled_mask = EvaluateRestrictNode(&child_element, variants, mask);
+                if (enabled_mask != 0)
+                    ForEachEnabledChild(&child_element, variants, enabled_mask, visitor);
+            }
+        }
+    }
 
-                if (element_name == "Restrict")
+    std::vector<PlatformMask> Parser::GroupPlatformVariants(const BreadcrumbElement* element, const PlatformVariants& variants,
+        PlatformMask mask, const std::vector<std::vector<std::string>>& root_paths)
+    {
+        std::vector<std::pair<std::vector<std::string>, PlatformMask>> groups;
+
+        for (size_t index = 0; index < variants.contexts.size(); index++)
+        {
+            if ((mask & (PlatformMask(1) << index)) == 0)
+                continue;
+
+            std::vector<std::string> values = root_paths[index];
+            for (const BreadcrumbAttribute& attribute : element->attributes)
+            {
+                std::string& value = values.emplace_back();
+                try
                 {
-                    if (element->NoChildren())
-                    {
-                        Logger::Warn("The <Restrict> node at {} (line {}) has no children and will be skipped",
-                            settings.GetTargetBreadcrumbFilename(), element->GetLineNum());
-                    }
-                    else
-                    {
-                        // Check for <Restrict> nodes in children first
-                        ProcessChildrenRestrictNodes(node, settings);
-
-                        // Evaluate the condition to know what to do with children nodes
-                        if (EvaluateRestrictNode(element, settings) == true)
-                        {
-                            // Move all children nodes up a level
-                            while (!element->NoChildren())
-                                element->Parent()->InsertAfterChild(element, element->FirstChild());
-                        }
-                        else
-                        {
-                            // Remove all children nodes
-                            node->DeleteChildren();
-                        }
-
-                        tinyxml2::XMLNode* prev = node->PreviousSibling();
-
-                        // Remove the <Restrict> node after it has been evaluated
-                        node->Parent()->DeleteChild(node);
-
-                        node = prev;
-                    }
+                    attribute.value_template.Instantiate(*variants.contexts[index].variables, value);
                 }
-                else
+                catch (const std::exception&)
                 {
-                    // Recursively check the entire XML document tree
-                    ProcessChildrenRestrictNodes(node, settings);
+                    // The error is reported when parsing the element
+                    value = std::string(1, '\0');
                 }
             }
 
-            node = node->NextSibling();
+            const auto group_it = std::find_if(groups.begin(), groups.end(),
+                [&values](const auto& group) { return group.first == values; });
+            if (group_it != groups.end())
+                group_it->second |= PlatformMask(1) << index;
+            else groups.emplace_back(std::move(values), PlatformMask(1) << index);
+        }
+
+        std::vector<PlatformMask> group_masks;
+        for (const auto& group : groups)
+            group_masks.push_back(group.second);
+        return group_masks;
+    }
+
+    void Parser::CompileRestrictNodes(BreadcrumbElement& root)
+    {
+        // Recursively check the entire document tree
+        for (BreadcrumbElement& element : root.children)
+        {
+            if (element.name == "Restrict")
+                element.restrict_predicate = CompileRestrictNode(element);
+
+            CompileRestrictNodes(element);
         }
     }
 
@@ -559,90 +738,118 @@ namespace Hansel
             }
             else
             {
-                throw std::exception(("'" + str + "' is not a valid <" + field_name + "> flag").c_str());
+                throw std::runtime_error(("'" + str + "' is not a valid <" + field_name + "> flag").c_str());
             }
         }
 
         if (result == T(0))
         {
-            throw std::exception("Platform specifier flags cannot be left empty");
+            throw std::runtime_error("Platform specifier flags cannot be left empty");
         }
         return result;
     }
 
-    bool Parser::EvaluateRestrictNode(const tinyxml2::XMLElement* restrict_element, const Settings& settings)
+    /* Compiles a single platform specifier attribute into a condition, deferring the parsing error (if any)
+        because the attributes which follow an unsatisfied condition are never evaluated */
+    template<Enum T>
+    static RestrictPredicate::Condition CompilePlatformCondition(RestrictPredicate::Condition::Type type,
+        const BreadcrumbAttribute& attribute, const std::map<std::string, T>& mapping)
     {
-        if (!restrict_element)
-            return false;
+        RestrictPredicate::Condition condition{ type };
+        try
+        {
+            condition.flags = uint16_t(ParsePlatformSpecifierFlags<T>(attribute.name, attribute.value, mapping));
+        }
+        catch (const std::exception& e)
+        {
+            condition.error = e.what();
+        }
+        return condition;
+    }
+
+    RestrictPredicate Parser::CompileRestrictNode(const BreadcrumbElement& restrict_element)
+    {
+        using ConditionType = RestrictPredicate::Condition::Type;
 
-        for (const tinyxml2::XMLAttribute* attribute = restrict_element->FirstAttribute();
-            attribute != nullptr;
-            attribute = attribute->Next())
+        RestrictPredicate predicate;
+        for (size_t index = 0; index < restrict_element.attributes.size(); index++)
         {
-            const std::string attribute_name_str = attribute->Name();
+            const BreadcrumbAttribute& attribute = restrict_element.attributes[index];
 
-            if (attribute_name_str == "Platform")
+            if (attribute.name == "Platform")
             {
-                // Read <Platform> attribute flags
-                const std::optional<std::string> platform_attribute = GetAttributeAsRawString(restrict_element, "Platform");
-                const Platform::OperatingSystem os_mask = ParsePlatformSpecifierFlags<Platform::OperatingSystem>
-                (
-                    "Platform",
-                    platform_attribute.value(),
-                    StringToOperatingSystemMapping
-                );
-
-                // Evaluate condition and exit immediately if not satisfied
-                if ((uint16_t(settings.platform.os) & uint16_t(os_mask)) == 0) 
-                    return false;
+                predicate.conditions.push_back(CompilePlatformCondition<Platform::OperatingSystem>
+                    (ConditionType::OperatingSystem, attribute, StringToOperatingSystemMapping));
             }
-            else if (attribute_name_str == "Architecture")
+            else if (attribute.name == "Architecture")
             {
-                // Read <Architecture> attribute flags
-                const std::optional<std::string> architecture_attribute = GetAttributeAsRawString(restrict_element, "Architecture");
-                const Platform::Architecture arch_mask = ParsePlatformSpecifierFlags<Platform::Architecture>
-                (
-                    "Architecture",
-                    architecture_attribute.value(),
-                    StringToArchitectureMapping
-                );
-
-                // Evaluate condition and exit immediately if not satisfied
-                if ((uint16_t(settings.platform.arch) & uint16_t(arch_mask)) == 0) 
-                    return false;
+                predicate.conditions.push_back(CompilePlatformCondition<Platform::Architecture>
+                    (ConditionType::Architecture, attribute, StringToArchitectureMapping));
             }
-            else if (attribute_name_str == "Configuration")
+            else if (attribute.name == "Configuration")
             {
-                // Read <Configuration> attribute flags
-                const std::optional<std::string> configuration_attribute = GetAttributeAsRawString(restrict_element, "Configuration");
-                const Platform::Configuration config_mask = ParsePlatformSpecifierFlags<Platform::Configuration>
-                (
-                    "Configuration",
-                    configuration_attribute.value(),
-                    StringToConfigurationMapping
-                );
-
-                // Evaluate condition and exit immediately if not satisfied
-                if ((uint16_t(settings.platform.config) & uint16_t(config_mask)) == 0) 
-                    return false;
+                predicate.conditions.push_back(CompilePlatformCondition<Platform::Configuration>
+                    (ConditionType::Configuration, attribute, StringToConfigurationMapping));
             }
             else
             {
-                // Look for an environment variable with the attribute name
-                const std::string variable_name_str = Utilities::UpperString(attribute_name_str);
-                if (settings.variables.contains(variable_name_str))
-                {
-                    const std::optional<std::string> variable_str = 
-                        GetAttributeAsSubstitutedString(restrict_element, attribute_name_str.c_str(), settings.variables);
+                // Any other attribute is compared with the environment variable of the same name
+                RestrictPredicate::Condition condition{ ConditionType::Variable };
+                condition.attribute_index = index;
+                condition.variable_name = Utilities::UpperString(attribute.name);
+                predicate.conditions.push_back(std::move(condition));
+            }
+        }
+
+        return predicate;
+    }
+
+    bool Parser::EvaluateRestrictNode(const BreadcrumbElement* restrict_element, const ParseContext& context)
+    {
+        if (!restrict_element || !restrict_element->restrict_predicate.has_value())
+            return false;
 
-                    // Evaluate condition and exit immediately if not satisfied
-                    if (settings.variables.at(variable_name_str) != variable_str.value()) 
+        for (const RestrictPredicate::Condition& condition : restrict_element->restrict_predicate->conditions)
+        {
+            if (!condition.error.empty())
+                throw std::runtime_error(condition.error.c_str());
+
+            // Evaluate each condition and exit immediately if not satisfied
+            switch (condition.type)
+            {
+                case RestrictPredicate::Condition::Type::OperatingSystem:
+                    if ((uint16_t(context.platform.os) & condition.flags) == 0)
                         return false;
-                }
-                else
+                    break;
+
+                case RestrictPredicate::Condition::Type::Architecture:
+                    if ((uint16_t(context.platform.arch) & condition.flags) == 0)
+                        return false;
+                    break;
+
+                case RestrictPredicate::Condition::Type::Configuration:
+                    if ((uint16_t(context.platform.config) & condition.flags) == 0)
+                        return false;
+                    break;
+
+                case RestrictPredicate::Condition::Type::Variable:
                 {
-                    throw std::exception(("The <Restrict> attribute '" + attribute_name_str 
-                        + "' does not match with any available filter or environment variable").c_str());
+                    const BreadcrumbAttribute& attribute = restrict_element->attributes[condition.attribute_index];
+
+                    const String* variable_value = context.variables->Find(condition.variable_name);
+                    if (variable_value == nullptr)
+                    {
+                        throw std::runtime_error(("The <Restrict> attribute '" + attribute.name
+                            + "' does not match with any available filter or environment variable").c_str());
+                    }
+
+                    thread_local std::string variable_str;
+                    variable_str.clear();
+                    attribute.value_template.Instantiate(*context.variables, variable_str);
+
+                    if (*variable_value != variable_str)
+                        return false;
+                    break;
                 }
             }
         }
@@ -651,7 +858,19 @@ namespace Hansel
     }
 
 
-    bool Parser::CheckDestinationAttribute(const tinyxml2::XMLElement* element)
+    PlatformMask Parser::EvaluateRestrictNode(const BreadcrumbElement* restrict_element, const PlatformVariants& variants, PlatformMask mask)
+    {
+        PlatformMask enabled_mask = 0;
+        for (size_t index = 0; index < variants.contexts.size(); index++)
+        {
+            if ((mask & (PlatformMask(1) << index)) != 0 && EvaluateRestrictNode(restrict_element, variants.contexts[index]))
+                enabled_mask |= PlatformMask(1) << index;
+        }
+        return enabled_mask;
+    }
+
+
+    bool Parser::CheckDestinationAttribute(const BreadcrumbElement* element)
     {
         const std::optional<std::string> attribute_string = GetAttributeAsRawString(element, "Destination");
         if (!attribute_string.has_value())
@@ -664,7 +883,7 @@ namespace Hansel
     }
 
 
-    std::optional<std::string> Parser::GetAttributeAsRawString(const tinyxml2::XMLElement* element, const char* attribute)
+    std::optional<std::string> Parser::GetAttributeAsRawString(const BreadcrumbElement* element, const char* attribute)
     {
         const char* attribute_value = element->Attribute(attribute);
         if (attribute_value == nullptr)
@@ -672,49 +891,22 @@ namespace Hansel
         return std::string(attribute_value);
     }
 
-    std::optional<std::string> Parser::GetAttributeAsSubstitutedString(const tinyxml2::XMLElement* element, const char* attribute, const Environment& environment)
+    std::optional<std::string> Parser::GetAttributeAsSubstitutedString(const BreadcrumbElement* element, const char* attribute, const ScopedEnvironment& environment)
     {
-        const std::optional<std::string> attribute_string = GetAttributeAsRawString(element, attribute);
-        if (!attribute_string.has_value())
+        const BreadcrumbAttribute* breadcrumb_attribute = element->FindAttribute(attribute);
+        if (breadcrumb_attribute == nullptr)
             return std::optional<std::string>(std::nullopt);
 
-        // Variable placeholders in attribute strings must be of the form $(NAME)
-        static const std::regex variable_regex("\\$\\([a-zA-Z1-9_]*\\)");
-
-        std::string attribute_value = attribute_string.value();
-
-        // Find all variable placeholders and substitute them with variable values
-        std::smatch variable_match;
-        while (std::regex_search(attribute_value, variable_match, variable_regex))
-        {
-            const size_t match_position = variable_match.position();
-            const size_t match_length = variable_match.length();
-
-            if (match_length > 3)
-            {
-                // Get variable name
-                const std::string& variable_name = Utilities::UpperString(attribute_value.substr(match_position + 2, match_length - 3));
-
-                // Find variable in map and get its value
-                const auto it = environment.find(variable_name);
-                if (it == environment.end())
-                    throw std::exception(("Cannot substitute $(" + variable_name + "), variable not defined").c_str());
-                const std::string& variable_value = it->second;
-
-                // Replace variable value into original string
-                attribute_value.erase(match_position, match_length);
-                attribute_value.insert(match_position, variable_value);
-            }
-            else
-            {
-                Logger::Warn("Empty variable placeholder '$()', skipping substitution");
-            }
-        }
+        // Attribute values are pre-compiled into templates when the breadcrumb is loaded, substituting variables
+        //  only requires concatenating the segments (in a buffer which is re-used by all calls on the same thread)
+        thread_local std::string substituted_value;
+        substituted_value.clear();
 
-        return attribute_value;
+        breadcrumb_attribute->value_template.Instantiate(environment, substituted_value);
+        return substituted_value;
     }
 
-    std::optional<Path> Parser::GetAttributeAsPath(const tinyxml2::XMLElement* element, const char* attribute, const Environment& environment)
+    std::optional<Path> Parser::GetAttributeAsPath(const BreadcrumbElement* element, const char* attribute, const ScopedEnvironment& environment)
     {
         const std::optional<std::string> path_string = GetAttributeAsSubstitutedString(element, attribute, environment);
         if (!path_string.has_value())
@@ -725,14 +917,31 @@ namespace Hansel
             const std::filesystem::path path(path_string.value());
             return Path(path.lexically_normal().string());
         }
-        catch (std::exception)
+        catch (const std::exception&)
         {
             Logger::Error("'{}' is not a valid path", path_string.value());
             return std::optional<Path>(std::nullopt);
         }
     }
 
-    std::optional<Version> Parser::GetAttributeAsVersion(const tinyxml2::XMLElement* element, const char* attribute)
+    std::vector<Path> Parser::GetAttributeAsPathList(const BreadcrumbElement* element, const char* attribute, const ParseContext& context)
+    {
+        const std::optional<std::string> paths_string = GetAttributeAsSubstitutedString(element, attribute, *context.variables);
+        if (!paths_string.has_value())
+            return {};
+
+        // A ';'-separated list of paths, relative paths are resolved from the directory of the breadcrumb
+        std::vector<Path> paths;
+        for (const std::string& path_string : Utilities::SplitString(paths_string.value(), ';'))
+        {
+            const std::string trimmed_path = Utilities::TrimString(path_string);
+            if (!trimmed_path.empty())
+                paths.push_back(Utilities::MakeAbsolutePath(trimmed_path, context.GetTargetDirectoryPath()));
+        }
+        return paths;
+    }
+
+    std::optional<Version> Parser::GetAttributeAsVersion(const BreadcrumbElement* element, const char* attribute)
     {
         // Version numbers must be in the form of MAJOR.MINOR[.PATCH] where
         // all three components are positive integer values, only numeric characters
@@ -745,7 +954,7 @@ namespace Hansel
 
         const std::string version_str = Utilities::TrimString(version_attribute.value());
         if (!std::regex_match(version_str, version_regex))
-            throw std::exception("Version number does not match the MAJOR.MINOR[.PATCH] format");
+            throw std::runtime_error("Version number does not match the MAJOR.MINOR[.PATCH] format");
 
         const std::vector<std::string> version_number_components = Utilities::SplitString(version_str, '.');
 
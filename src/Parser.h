@@ -1,14 +1,11 @@
 #pragma once
 
 #include "Types.h"
+#include "Breadcrumb.h"
+#include "ScopedEnvironment.h"
 #include "Dependencies.h"
-
-// Forward declaration of tinyxml2 types
-namespace tinyxml2
-{
-    class XMLElement;
-    class XMLNode;
-};
+#include "FileSystemCache.h"
+#include "ThreadPool.h"
 
 
 namespace Hansel
@@ -21,34 +18,101 @@ namespace Hansel
             evaluating <Restrict> nodes and returning the list of dependencies described by the file.
            If some of the dependencies have their own breadcrumb file, the parsing and evaluation
             proceeds recursively until the entire dependency sub-tree is built.
+           Breadcrumbs that are referenced multiple times with the same platform and environment
+            are parsed only once, and all references share the same dependency sub-tree.
+           If 'settings.cache_dir' is specified, breadcrumb files are loaded from their compiled form
+            (when up-to-date) which is stored in that directory.
+           With 'settings.jobs' greater than 1, sibling <Project> and <Library> sub-trees are parsed
+            concurrently, but the resulting order and the reported errors are the same as a serial parse.
+           With multiple 'settings.platforms', breadcrumbs are parsed once for all of them and each dependency
+            is tagged with the platforms for which it's enabled (see Dependency::SelectPlatform()).
            Throws an std::exception for any unrecoverable issue that is encountered during parsing. */
         static std::vector<Dependency*> ParseBreadcrumb(const Path& path_to_breadcrumb, const Settings& settings);
 
     private:
 
+        // Parsing state of a breadcrumb for a single target platform (nested breadcrumbs only change the target and some variables)
+        struct ParseContext
+        {
+            const Settings* settings = nullptr;
+            Platform platform;
+            Path target;
+            std::shared_ptr<const ScopedEnvironment> variables;
+
+            // The canonical target path is resolved once and shared by all lookups (see FileSystemCache)
+            String GetTargetBreadcrumbFilename() const { return std::filesystem::path(FileSystemCache::Canonical(target)).filename().string(); }
+            Path GetTargetDirectoryPath() const { return std::filesystem::path(FileSystemCache::Canonical(target)).parent_path().string(); }
+        };
+
+        // Context of each target platform (indexed as Settings::platforms), for the platforms which are parsed together
+        struct PlatformVariants
+        {
+            PlatformMask mask;
+            std::vector<ParseContext> contexts;
+        };
+
+        // Uniquely identifies the result of parsing a breadcrumb file with a given set of settings
+        struct BreadcrumbCacheKey
+        {
+            Path path;
+            PlatformMask platforms;
+            std::vector<ScopedEnvironment> variables;
+
+            auto operator<=>(const BreadcrumbCacheKey& other) const = default;
+        };
+
+        // Parsed breadcrumbs, memoized for the entire execution
+        static std::map<BreadcrumbCacheKey, std::vector<Dependency*>> BreadcrumbCache;
+        static std::mutex BreadcrumbCacheMutex;
+
+        // Worker threads used for parsing sub-trees concurrently (only when running with multiple jobs)
+        static std::unique_ptr<ThreadPool> ParserThreadPool;
+
+        // Loaded breadcrumb files (with pre-compiled attributes), indexed by their canonical path
+        static std::map<Path, std::shared_ptr<const BreadcrumbElement>> DocumentCache;
+        static std::mutex DocumentCacheMutex;
+
+        // Breadcrumb document loading and parsing
+        static std::shared_ptr<const BreadcrumbElement> LoadBreadcrumbDocument(const Path& path_to_breadcrumb, const Path& canonical_path, const ParseContext& context);
+        static std::vector<Dependency*> ParseBreadcrumb(const Path& path_to_breadcrumb, const PlatformVariants& variants);
+        static std::vector<Dependency*> ParseBreadcrumbDocument(const Path& path_to_breadcrumb, const Path& canonical_path, const PlatformVariants& variants);
+
         // Dependency nodes parsing
-        static std::vector<Dependency*> ParseDependencies(const tinyxml2::XMLElement* dependencies_element, const Settings& settings);
+        static std::vector<Dependency*> ParseDependencies(const BreadcrumbElement* dependencies_element, const PlatformVariants& variants, PlatformMask mask);
 
-        static ProjectDependency*   ParseProjectDependency(const tinyxml2::XMLElement* project_element, const Settings& settings, const std::vector<std::string>& project_root_paths);
-        static LibraryDependency*   ParseLibraryDependency(const tinyxml2::XMLElement* library_element, const Settings& settings, const std::vector<std::string>& library_root_paths);
-        static FileDependency*      ParseFileDependency(const tinyxml2::XMLElement* file_element, const Settings& settings);
-        static FilesDependency*     ParseFilesDependency(const tinyxml2::XMLElement* files_element, const Settings& settings);
-        static DirectoryDependency* ParseDirectoryDependency(const tinyxml2::XMLElement* directory_element, const Settings& settings);
-        static CommandDependency*   ParseCommandDependency(const tinyxml2::XMLElement* command_element, const Settings& settings);
-        static ScriptDependency*    ParseScriptDependency(const tinyxml2::XMLElement* script_element, const Settings& settings, const std::vector<std::string>& script_root_paths);
+        static ProjectDependency*   ParseProjectDependency(const BreadcrumbElement* project_element, const PlatformVariants& variants, PlatformMask mask, const std::vector<std::string>& project_root_paths);
+        static LibraryDependency*   ParseLibraryDependency(const BreadcrumbElement* library_element, const PlatformVariants& variants, PlatformMask mask, const std::vector<std::string>& library_root_paths);
+        static FileDependency*      ParseFileDependency(const BreadcrumbElement* file_element, const ParseContext& context);
+        static FilesDependency*     ParseFilesDependency(const BreadcrumbElement* files_element, const ParseContext& context);
+        static DirectoryDependency* ParseDirectoryDependency(const BreadcrumbElement* directory_element, const ParseContext& context);
+        static CommandDependency*   ParseCommandDependency(const BreadcrumbElement* command_element, const ParseContext& context);
+        static ScriptDependency*    ParseScriptDependency(const BreadcrumbElement* script_element, const ParseContext& context, const std::vector<std::string>& script_root_paths);
 
         // Restrict nodes handling
-        static void ProcessChildrenRestrictNodes(tinyxml2::XMLNode* root, const Settings& settings);
-        static bool EvaluateRestrictNode(const tinyxml2::XMLElement* restrict_element, const Settings& settings);
+        static void CompileRestrictNodes(BreadcrumbElement& root);
+        static RestrictPredicate CompileRestrictNode(const BreadcrumbElement& restrict_element);
+        static bool EvaluateRestrictNode(const BreadcrumbElement* restrict_element, const ParseContext& context);
+        static PlatformMask EvaluateRestrictNode(const BreadcrumbElement* restrict_element, const PlatformVariants& variants, PlatformMask mask);
+
+        /* Calls 'visitor' on each child element of 'element' with the platforms (out of 'mask') for which it's enabled,
+            descending into the <Restrict> blocks whose condition is satisfied for at least one of the platforms and
+            skipping the others (the element tree is never modified, so it can be shared) */
+        template<typename Visitor>
+        static void ForEachEnabledChild(const BreadcrumbElement* element, const PlatformVariants& variants, PlatformMask mask, Visitor&& visitor);
+
+        // Groups the platforms in 'mask' for which all attributes of 'element' (and the lookup paths) have the same value
+        static std::vector<PlatformMask> GroupPlatformVariants(const BreadcrumbElement* element, const PlatformVariants& variants,
+            PlatformMask mask, const std::vector<std::vector<std::string>>& root_paths);
 
         // Validity checks for attribute strings
-        static bool CheckDestinationAttribute(const tinyxml2::XMLElement* element);
+        static bool CheckDestinationAttribute(const BreadcrumbElement* element);
 
         // XML attributes parsing
-        static std::optional<String>    GetAttributeAsRawString(const tinyxml2::XMLElement* element, const char* attribute);
-        static std::optional<String>    GetAttributeAsSubstitutedString(const tinyxml2::XMLElement* element, const char* attribute, const Environment& environment);
-        static std::optional<Path>      GetAttributeAsPath(const tinyxml2::XMLElement* element, const char* attribute, const Environment& environment);
-        static std::optional<Version>   GetAttributeAsVersion(const tinyxml2::XMLElement* element, const char* attribute);
+        static std::optional<String>    GetAttributeAsRawString(const BreadcrumbElement* element, const char* attribute);
+        static std::optional<String>    GetAttributeAsSubstitutedString(const BreadcrumbElement* element, const char* attribute, const ScopedEnvironment& environment);
+        static std::optional<Path>      GetAttributeAsPath(const BreadcrumbElement* element, const char* attribute, const ScopedEnvironment& environment);
+        static std::vector<Path>        GetAttributeAsPathList(const BreadcrumbElement* element, const char* attribute, const ParseContext& context);
+        static std::optional<Version>   GetAttributeAsVersion(const BreadcrumbElement* element, const char* attribute);
 
 
         // Keyword mappings for plaftorm specifier flags
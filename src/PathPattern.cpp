@@ -0,0 +1,164 @@
+#include "PathPattern.h"
+
+#include <algorithm>
+#include <future>
+
+
+namespace Hansel
+{
+    static bool HasWildcards(const String& component)
+    {
+        return component.find_first_of("*?[") != String::npos;
+    }
+
+
+    PathPattern::PathPattern(const Path& pattern)
+        : pattern(pattern)
+    {
+        const std::filesystem::path pattern_path(pattern);
+
+        std::vector<String> components;
+        for (const auto& component : pattern_path)
+            components.push_back(component.string());
+
+        // The last component is always matched against the directory entries, even without wildcards
+        size_t first_segment = components.empty() ? 0 : components.size() - 1;
+        for (size_t i = 0; i + 1 < components.size(); i++)
+        {
+            if (HasWildcards(components[i]))
+            {
+                first_segment = i;
+                break;
+            }
+        }
+
+        // Strip the segments from the pattern, so that the base directory is spelled as in the original path
+        std::filesystem::path base_path = pattern_path;
+        for (size_t i = first_segment; i < components.size(); i++)
+            base_path = base_path.parent_path();
+        base_directory = base_path.string();
+
+        for (size_t i = first_segment; i < components.size(); i++)
+        {
+            const bool recursive = components[i] == "**";
+            if (recursive && !segments.empty() && segments.back().recursive)
+                continue;   // consecutive '**' are equivalent to a single one
+
+            segments.push_back(Segment{ recursive, GlobPattern(components[i]) });
+        }
+    }
+
+    std::vector<Path> PathPattern::Expand() const
+    {
+        return WalkDirectory(base_directory, Closure({ 0 }));
+    }
+
+    void PathPattern::SetThreadCount(uint32_t thread_count)
+    {
+        if (thread_count > 1 && !s_ThreadPool)
+            s_ThreadPool = std::make_unique<ThreadPool>(thread_count - 1);
+    }
+
+
+    PathPattern::States PathPattern::Closure(States states) const
+    {
+        for (size_t i = 0; i < states.size(); i++)
+        {
+            const size_t state = states[i];
+            if (state < segments.size() && segments[state].recursive)
+                states.push_back(state + 1);
+        }
+
+        std::sort(states.begin(), states.end());
+        states.erase(std::unique(states.begin(), states.end()), states.end());
+
+        // Once past the last segment everything matches, the other states can't add anything
+        if (!states.empty() && states.back() == segments.size())
+            return { segments.size() };
+        return states;
+    }
+
+    std::vector<Path> PathPattern::WalkDirectory(const Path& directory, const States& states) const
+    {
+        // The results of each entry are kept in listing order, sub-directories may be walked by other threads
+        struct EntryResult
+        {
+            Path                            file;
+            std::vector<Path>               files;
+            std::future<std::vector<Path>>  pending_files;
+        };
+        std::vector<EntryResult> results;
+
+        for (auto const& dir_entry : std::filesystem::directory_iterator{ std::filesystem::path(directory) })
+        {
+            const bool is_file = dir_entry.is_regular_file();
+            const bool is_directory = !is_file && dir_entry.is_directory();
+            if (!is_file && !is_directory)
+                continue;
+
+            const String name = dir_entry.path().filename().string();
+
+            bool file_matches = false;
+            States child_states;
+            for (const size_t state : states)
+            {
+                if (state == segments.size())
+                {
+                    // Inside a matched directory (or after a trailing '**'), all files are included
+                    file_matches = true;
+                    child_states.push_back(state);
+                }
+                else if (segments[state].recursive)
+                {
+                    // Following links could lead to cycles, only the explicit components of the pattern resolve them
+                    if (is_directory && !dir_entry.is_symlink())
+                        child_states.push_back(state);
+                }
+                else if (segments[state].pattern.Match(name))
+                {
+                    if (state + 1 == segments.size())
+                        file_matches = true;
+                    child_states.push_back(state + 1);
+                }
+            }
+
+            if (is_file)
+            {
+                if (file_matches)
+                    results.push_back(EntryResult{ dir_entry.path().string(), {}, {} });
+            }
+            else if (!child_states.empty())
+            {
+                const Path subdirectory = dir_entry.path().string();
+                child_states = Closure(std::move(child_states));
+
+                EntryResult& result = results.emplace_back();
+                if (s_ThreadPool)
+                {
+                    result.pending_files = s_ThreadPool->Submit([this, subdirectory, child_states]()
+                        { return WalkDirectory(subdirectory, child_states); });
+                }
+                else
+                {
+                    result.files = WalkDirectory(subdirectory, child_states);
+                }
+            }
+        }
+
+        std::vector<Path> files;
+        for (EntryResult& result : results)
+        {
+            if (result.pending_files.valid())
+            {
+                s_ThreadPool->Wait(result.pending_files);
+                result.files = result.pending_files.get();
+            }
+
+            if (!result.file.empty())
+                files.push_back(std::move(result.file));
+            files.insert(files.end(), std::make_move_iterator(result.files.begin()), std::make_move_iterator(result.files.end()));
+        }
+
+        return files;
+    }
+}
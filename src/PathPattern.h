@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Types.h"
+#include "GlobPattern.h"
+#include "ThreadPool.h"
+
+
+namespace Hansel
+{
+    /* Path pattern of a <Files> dependency, compiled once and expanded by walking the directory tree.
+       The leading components without wildcards form the base directory, each of the following components
+        is matched against the entries of one directory level and '**' matches any number of directory levels
+        (including none), so that a single pattern can match files at any depth of a directory tree.
+       Directories matched by the last component are included with all of their files.
+       Sub-directories are walked concurrently (see SetThreadCount()) and only those which can still match
+        the rest of the pattern are visited. The order of the results doesn't depend on the number of threads. */
+    class PathPattern
+    {
+    public:
+
+        PathPattern() = default;
+        explicit PathPattern(const Path& pattern);
+
+        /* Returns the paths of all the files which match the pattern, in the order in which directories are listed.
+           Throws an std::filesystem::filesystem_error if the base directory cannot be listed. */
+        std::vector<Path> Expand() const;
+
+        const Path& GetPattern() const { return pattern; }
+
+        // Directory to which the relative paths of the matched files refer
+        const Path& GetBaseDirectory() const { return base_directory; }
+
+        // Sets the number of threads used to walk directory trees (1 means that walking is done serially)
+        static void SetThreadCount(uint32_t thread_count);
+
+    private:
+
+        struct Segment
+        {
+            bool        recursive;  // '**'
+            GlobPattern pattern;
+        };
+
+        using States = std::vector<size_t>;
+
+        // Adds the states reached by letting '**' segments match no directory at all
+        States Closure(States states) const;
+
+        // Returns the matching files in 'directory', given the segments which its entries can match
+        std::vector<Path> WalkDirectory(const Path& directory, const States& states) const;
+
+        Path                    pattern;
+        Path                    base_directory;
+        std::vector<Segment>    segments;
+
+        inline static std::unique_ptr<ThreadPool> s_ThreadPool;
+    };
+}
@@ -0,0 +1,302 @@
+#include "ProcessRunner.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <poll.h>
+    #include <spawn.h>
+    #include <sys/syscall.h>
+    #include <sys/wait.h>
+    #include <unistd.h>
+
+    extern char** environ;
+#endif
+
+
+namespace Hansel
+{
+#ifndef _WIN32
+    // Interval at which processes are checked for completion, when the kernel can't notify it (before Linux 5.3)
+    static constexpr int COMPLETION_CHECK_INTERVAL_MS = 50;
+
+    /* Process started by the runner, with the read ends of its output pipes (-1 once they have been closed)
+        and a descriptor which becomes readable when it exits (-1 if the kernel doesn't support it) */
+    struct RunningProcess
+    {
+        size_t index = 0;
+        pid_t  pid = -1;
+        int    output_fd = -1;
+        int    errors_fd = -1;
+        int    process_fd = -1;
+    };
+
+    static std::error_code GetLastError()
+    {
+        return std::error_code(errno, std::system_category());
+    }
+
+    static std::error_code CreatePipe(int fds[2])
+    {
+        // Neither end is inherited by the other processes, the child only gets the write end as a standard stream
+        if (pipe(fds) != 0)
+            return GetLastError();
+
+        fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+        fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+        // The read end is drained without blocking once the process has exited (see DrainPipe())
+        fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+        return {};
+    }
+
+    static int OpenProcessFd(pid_t pid)
+    {
+#ifdef SYS_pidfd_open
+        return int(syscall(SYS_pidfd_open, pid, 0));
+#else
+        return -1;
+#endif
+    }
+
+    // Starts a process which writes to the standard streams of Hansel
+    static std::error_code StartProcess(const String& command_line, pid_t& pid)
+    {
+        const char* const arguments[] = { "sh", "-c", command_line.c_str(), nullptr };
+        const int result = posix_spawn(&pid, "/bin/sh", nullptr, nullptr, const_cast<char* const*>(arguments), environ);
+        return (result != 0) ? std::error_code(result, std::system_category()) : std::error_code();
+    }
+
+    // Starts a process whose standard streams are redirected to pipes
+    static std::error_code StartProcess(const String& command_line, RunningProcess& process)
+    {
+        int output_pipe[2];
+        int errors_pipe[2];
+        std::error_code err = CreatePipe(output_pipe);
+        if (err.value() != 0)
+            return err;
+
+        err = CreatePipe(errors_pipe);
+        if (err.value() != 0)
+        {
+            close(output_pipe[0]);
+            close(output_pipe[1]);
+            return err;
+        }
+
+        posix_spawn_file_actions_t file_actions;
+        posix_spawn_file_actions_init(&file_actions);
+        posix_spawn_file_actions_adddup2(&file_actions, output_pipe[1], STDOUT_FILENO);
+        posix_spawn_file_actions_adddup2(&file_actions, errors_pipe[1], STDERR_FILENO);
+
+        const char* const arguments[] = { "sh", "-c", command_line.c_str(), nullptr };
+        const int result = posix_spawn(&process.pid, "/bin/sh", &file_actions, nullptr,
+            const_cast<char* const*>(arguments), environ);
+        posix_spawn_file_actions_destroy(&file_actions);
+
+        close(output_pipe[1]);
+        close(errors_pipe[1]);
+        if (result != 0)
+        {
+            close(output_pipe[0]);
+            close(errors_pipe[0]);
+            return std::error_code(result, std::system_category());
+        }
+
+        process.output_fd = output_pipe[0];
+        process.errors_fd = errors_pipe[0];
+        process.process_fd = OpenProcessFd(process.pid);
+        return {};
+    }
+
+    static void CloseDescriptor(int& fd)
+    {
+        if (fd >= 0)
+            close(fd);
+        fd = -1;
+    }
+
+    // Appends what is available on the pipe to the buffer, closes it when the process has closed its end
+    static void ReadPipe(int& fd, std::string& buffer)
+    {
+        char chunk[64 * 1024];
+        const ssize_t size = read(fd, chunk, sizeof(chunk));
+        if (size > 0)
+        {
+            buffer.append(chunk, size_t(size));
+            return;
+        }
+
+        if (size < 0 && (errno == EINTR || errno == EAGAIN))
+            return;
+
+        CloseDescriptor(fd);
+    }
+
+    /* Appends everything which is already on the pipe to the buffer, then closes it: the background processes
+        which a command may have started keep its write end open, their output isn't waited for */
+    static void DrainPipe(int& fd, std::string& buffer)
+    {
+        char chunk[64 * 1024];
+        while (fd >= 0)
+        {
+            const ssize_t size = read(fd, chunk, sizeof(chunk));
+            if (size > 0)
+                buffer.append(chunk, size_t(size));
+            else if (size < 0 && errno == EINTR)
+                continue;
+            else
+                CloseDescriptor(fd);
+        }
+    }
+
+    static int GetExitCode(int status)
+    {
+        if (WIFSIGNALED(status))
+            return 128 + WTERMSIG(status);
+        return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+    }
+
+    static int WaitProcess(pid_t pid)
+    {
+        int status = 0;
+        while (waitpid(pid, &status, 0) < 0)
+        {
+            if (errno != EINTR)
+                return -1;
+        }
+        return GetExitCode(status);
+    }
+
+    // Returns true if the process has exited, with its exit code (it can't be waited for anymore)
+    static bool HasExited(pid_t pid, int& exit_code)
+    {
+        int status = 0;
+        pid_t result;
+        do
+        {
+            result = waitpid(pid, &status, WNOHANG);
+        } while (result < 0 && errno == EINTR);
+
+        if (result == 0)
+            return false;
+
+        exit_code = (result < 0) ? -1 : GetExitCode(status);
+        return true;
+    }
+#endif
+
+
+    std::vector<ProcessRunner::Result> ProcessRunner::Run(const std::vector<String>& command_lines, uint32_t max_processes)
+    {
+        std::vector<Result> results(command_lines.size());
+
+#ifdef _WIN32
+        // Check the system command processor availability
+        if (!std::system(nullptr))
+        {
+            for (Result& result : results)
+                result.error = std::make_error_code(std::errc::no_such_file_or_directory);
+            return results;
+        }
+
+        for (size_t i = 0; i < command_lines.size(); i++)
+        {
+            // An explicit flush of std::cout is necessary before a call to std::system,
+            //  if the spawned process performs any screen I/O.
+            std::cout.flush();
+            std::fflush(stdout);
+
+            results[i].exit_code = std::system(command_lines[i].c_str());
+        }
+#else
+        // Commands which run alone don't need to be captured, their output is seen while they are running
+        if (max_processes <= 1 || command_lines.size() == 1)
+        {
+            for (size_t i = 0; i < command_lines.size(); i++)
+            {
+                pid_t pid = -1;
+                results[i].error = StartProcess(command_lines[i], pid);
+                if (results[i].error.value() == 0)
+                    results[i].exit_code = WaitProcess(pid);
+            }
+            return results;
+        }
+
+        // A single thread waits for the outputs of all the running processes, and starts
+        //  the next command as soon as one of them has completed
+        std::vector<RunningProcess> running;
+        size_t next = 0;
+        while (next < command_lines.size() || !running.empty())
+        {
+            while (running.size() < std::max<uint32_t>(max_processes, 1) && next < command_lines.size())
+            {
+                RunningProcess process{ next };
+                results[next].error = StartProcess(command_lines[next], process);
+                if (results[next].error.value() == 0)
+                    running.push_back(process);
+                next++;
+            }
+
+            // Wake up when a process writes to its outputs or exits, which is only checked periodically
+            //  if the kernel can't notify it
+            std::vector<pollfd> poll_fds;
+            int timeout = -1;
+            for (const RunningProcess& process : running)
+            {
+                for (const int fd : { process.output_fd, process.errors_fd, process.process_fd })
+                {
+                    if (fd >= 0)
+                        poll_fds.push_back(pollfd{ fd, POLLIN, 0 });
+                }
+                if (process.process_fd < 0)
+                    timeout = COMPLETION_CHECK_INTERVAL_MS;
+            }
+
+            if (!poll_fds.empty() && poll(poll_fds.data(), nfds_t(poll_fds.size()), timeout) < 0 && errno != EINTR)
+            {
+                // Without a way to wait for the outputs, they are read until the end one process at a time
+                for (pollfd& poll_fd : poll_fds)
+                    poll_fd.revents = POLLIN;
+            }
+
+            size_t poll_index = 0;
+            for (RunningProcess& process : running)
+            {
+                Result& result = results[process.index];
+                if (process.output_fd >= 0 && poll_fds[poll_index++].revents != 0)
+                    ReadPipe(process.output_fd, result.output);
+                if (process.errors_fd >= 0 && poll_fds[poll_index++].revents != 0)
+                    ReadPipe(process.errors_fd, result.errors);
+                if (process.process_fd >= 0)
+                    poll_index++;
+            }
+
+            // A process has completed once its shell has exited, even if it has started background processes
+            //  which still hold its outputs; processes whose outputs have both been closed are about to exit
+            for (auto it = running.begin(); it != running.end();)
+            {
+                Result& result = results[it->index];
+                const bool outputs_closed = (it->output_fd < 0 && it->errors_fd < 0);
+                if (outputs_closed)
+                    result.exit_code = WaitProcess(it->pid);
+                else if (!HasExited(it->pid, result.exit_code))
+                {
+                    it++;
+                    continue;
+                }
+
+                DrainPipe(it->output_fd, result.output);
+                DrainPipe(it->errors_fd, result.errors);
+                CloseDescriptor(it->process_fd);
+                it = running.erase(it);
+            }
+        }
+#endif
+
+        return results;
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "Types.h"
+
+
+namespace Hansel
+{
+    /* Runs command lines with the system shell, several of them at the same time if allowed.
+       On POSIX systems each command is started with posix_spawn() (/bin/sh -c <command>), which is cheaper than
+        the fork() of std::system(). When several commands can run at the same time, their standard output and
+        error streams are captured into separate buffers, so that the outputs of concurrent commands are never
+        interleaved; a command which runs alone writes directly to the standard streams, as it produces its output.
+       On Windows, commands are executed one at a time with std::system(), and their output is not captured. */
+    class ProcessRunner
+    {
+    public:
+
+        struct Result
+        {
+            std::error_code error;      // set if the command couldn't be executed at all
+            int exit_code = 0;          // 128 + signal number if the process has been terminated by a signal
+            std::string output;         // captured outputs, empty if they have been written directly
+            std::string errors;
+        };
+
+        /* Runs all the command lines, with at most 'max_processes' of them running at the same time,
+            and waits for their completion. Returns the results in the same order as the command lines. */
+        static std::vector<Result> Run(const std::vector<String>& command_lines, uint32_t max_processes);
+    };
+}
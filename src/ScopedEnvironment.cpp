@@ -0,0 +1,43 @@
+#include "ScopedEnvironment.h"
+
+
+namespace Hansel
+{
+    ScopedEnvironment::ScopedEnvironment(Environment variables)
+        : variables(std::move(variables))
+    {}
+
+    ScopedEnvironment::ScopedEnvironment(std::shared_ptr<const ScopedEnvironment> parent, Environment overrides)
+        : parent(std::move(parent)), variables(std::move(overrides))
+    {
+        // e.g. the scope of a library nested in another library only needs the top-level scope and its own OUTPUT_DIR
+        while (this->parent && this->parent->parent)
+        {
+            bool hidden = true;
+            for (const auto& [name, value] : this->parent->variables)
+            {
+                if (!variables.contains(name))
+                {
+                    hidden = false;
+                    break;
+                }
+            }
+
+            if (!hidden)
+                break;
+            this->parent = this->parent->parent;
+        }
+    }
+
+
+    const String* ScopedEnvironment::Find(const String& name) const
+    {
+        for (const ScopedEnvironment* scope = this; scope != nullptr; scope = scope->parent.get())
+        {
+            const auto it = scope->variables.find(name);
+            if (it != scope->variables.end())
+                return &it->second;
+        }
+        return nullptr;
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Types.h"
+
+
+namespace Hansel
+{
+    /* Chain of variable scopes, where each scope only stores the variables that it defines (or overrides)
+        and refers to its parent scope for all the others, so that nested scopes never copy the variables
+        of the outer ones. Variable names are always upper-case.
+       Scopes are immutable once created, so they can be shared between threads. */
+    class ScopedEnvironment
+    {
+    public:
+
+        // Creates a top-level scope, holding all the given variables
+        explicit ScopedEnvironment(Environment variables);
+
+        /* Creates a nested scope, which overrides (or adds) the given variables to those of 'parent'.
+           Outer scopes whose variables are all overridden are skipped, so the chain doesn't grow with the nesting depth. */
+        ScopedEnvironment(std::shared_ptr<const ScopedEnvironment> parent, Environment overrides);
+
+        // Returns the value of the variable with the given name, or nullptr if not defined in any scope
+        const String* Find(const String& name) const;
+
+        bool Contains(const String& name) const { return Find(name) != nullptr; }
+
+        // Scopes are equal if they define the same variables on top of the same parent scope
+        auto operator<=>(const ScopedEnvironment& other) const = default;
+
+    private:
+
+        std::shared_ptr<const ScopedEnvironment> parent;
+        Environment variables;
+    };
+}
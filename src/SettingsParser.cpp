@@ -1,12 +1,27 @@
 #include "SettingsParser.h"
+#include "FileSystemCache.h"
 #include "Logger.h"
 #include "Utilities.h"
 
+#include <algorithm>
+#include <charconv>
 #include <set>
+#include <stdexcept>
 
 
 namespace Hansel
 {
+    String Settings::GetTargetBreadcrumbFilename() const
+    {
+        return std::filesystem::path(FileSystemCache::Canonical(target)).filename().string();
+    }
+
+    Path Settings::GetTargetDirectoryPath() const
+    {
+        return std::filesystem::path(FileSystemCache::Canonical(target)).parent_path().string();
+    }
+
+
     const std::map<std::string, Settings::Mode>
         SettingsParser::StringToModeMapping
     {
@@ -42,13 +57,22 @@ namespace Hansel
         { "linux64d",  { Platform::OperatingSystem::Linux, Platform::Architecture::x64, Platform::Configuration::Debug } }
     };
 
+    const std::map<std::string, Settings::LinkMode>
+        SettingsParser::StringToLinkModeMapping
+    {
+        { "copy",     Settings::LinkMode::Copy },
+        { "hardlink", Settings::LinkMode::Hardlink },
+        { "symlink",  Settings::LinkMode::Symlink },
+        { "auto",     Settings::LinkMode::Auto }
+    };
+
 
     Settings SettingsParser::ParseCommandLine(const int argc, const char* const argv[])
     {
         Settings settings;
 
         if (argc < 2)
-            throw std::exception("Insufficient number of parameters");
+            throw std::runtime_error("Insufficient number of parameters");
 
         int index = 1;
 
@@ -63,12 +87,12 @@ namespace Hansel
         }
 
         if (settings.mode != Settings::Mode::Help && argc < 4)
-            throw std::exception("Insufficient number of parameters");
+            throw std::runtime_error("Insufficient number of parameters");
 
         if ((settings.mode == Settings::Mode::Install ||
              settings.mode == Settings::Mode::Debug   ||
              settings.mode == Settings::Mode::Check)  && argc < 5)
-            throw std::exception("Insufficient number of parameters");
+            throw std::runtime_error("Insufficient number of parameters");
 
         //! Path to target
         settings.target = ReadPathParam(argv, index++, "target");
@@ -79,8 +103,9 @@ namespace Hansel
             settings.mode == Settings::Mode::Check)
             settings.output = ReadPathParam(argv, index++, "install-dir");
 
-        //! Platform specifier
-        settings.platform = ReadSpecialParam<Platform>(argv, index++, "platform", SettingsParser::StringToPlatformMapping);
+        //! Platform specifier(s)
+        settings.platforms = ReadPlatformListParam(argv, index++, "platform");
+        settings.platform = settings.platforms.front();
 
         //! Additional options
         std::set<std::string> parsed_options;
@@ -94,7 +119,7 @@ namespace Hansel
                 static const std::string VerboseOptionName = "verbose";
 
                 if (parsed_options.contains(VerboseOptionName))
-                    throw std::exception(("Option '" + VerboseOptionName + "' has been specified multiple times").c_str());
+                    throw std::runtime_error(("Option '" + VerboseOptionName + "' has been specified multiple times").c_str());
                 parsed_options.insert(VerboseOptionName);
 
                 settings.verbose = true;
@@ -102,8 +127,112 @@ namespace Hansel
                 continue;
             }
 
+            //! Force flag
+            if (option_str == "--force")
+            {
+                static const std::string ForceOptionName = "force";
+
+                if (parsed_options.contains(ForceOptionName))
+                    throw std::runtime_error(("Option '" + ForceOptionName + "' has been specified multiple times").c_str());
+                parsed_options.insert(ForceOptionName);
+
+                settings.force = true;
+                continue;
+            }
+
+            //! Prune flag
+            if (option_str == "--prune")
+            {
+                static const std::string PruneOptionName = "prune";
+
+                if (parsed_options.contains(PruneOptionName))
+                    throw std::runtime_error(("Option '" + PruneOptionName + "' has been specified multiple times").c_str());
+                parsed_options.insert(PruneOptionName);
+
+                settings.prune = true;
+                continue;
+            }
+
             if (index == argc)
-                throw std::exception(("Option '" + option_str + "' is not followed by any value").c_str());
+                throw std::runtime_error(("Option '" + option_str + "' is not followed by any value").c_str());
+
+            //! Number of parallel jobs
+            if (option_str == "-j" || option_str == "--jobs")
+            {
+                static const std::string JobsOptionName = "jobs";
+
+                if (parsed_options.contains(JobsOptionName))
+                    throw std::runtime_error(("Option '" + JobsOptionName + "' has been specified multiple times").c_str());
+                parsed_options.insert(JobsOptionName);
+
+                settings.jobs = ReadUInt32Param(argv, index++, JobsOptionName);
+                continue;
+            }
+
+            //! Installation of files as copies or links
+            if (option_str == "--link-mode")
+            {
+                static const std::string LinkModeOptionName = "link-mode";
+
+                if (parsed_options.contains(LinkModeOptionName))
+                    throw std::runtime_error(("Option '" + LinkModeOptionName + "' has been specified multiple times").c_str());
+                parsed_options.insert(LinkModeOptionName);
+
+                settings.link_mode = ReadSpecialParam<Settings::LinkMode>(argv, index++, LinkModeOptionName, StringToLinkModeMapping);
+                continue;
+            }
+
+            //! Batched file copies with io_uring
+            if (option_str == "--io-uring")
+            {
+                static const std::string IoUringOptionName = "io-uring";
+
+                if (parsed_options.contains(IoUringOptionName))
+                    throw std::runtime_error(("Option '" + IoUringOptionName + "' has been specified multiple times").c_str());
+                parsed_options.insert(IoUringOptionName);
+
+                settings.io_uring_depth = ReadUInt32Param(argv, index++, IoUringOptionName);
+                continue;
+            }
+
+            //! Content-addressed store of installed files
+            if (option_str == "--store")
+            {
+                static const std::string StoreOptionName = "store";
+
+                if (parsed_options.contains(StoreOptionName))
+                    throw std::runtime_error(("Option '" + StoreOptionName + "' has been specified multiple times").c_str());
+                parsed_options.insert(StoreOptionName);
+
+                settings.store_dir = ReadPathParam(argv, index++, StoreOptionName);
+                continue;
+            }
+
+            //! Concurrent execution of commands and scripts
+            if (option_str == "--max-procs")
+            {
+                static const std::string MaxProcsOptionName = "max-procs";
+
+                if (parsed_options.contains(MaxProcsOptionName))
+                    throw std::runtime_error(("Option '" + MaxProcsOptionName + "' has been specified multiple times").c_str());
+                parsed_options.insert(MaxProcsOptionName);
+
+                settings.max_procs = ReadUInt32Param(argv, index++, MaxProcsOptionName);
+                continue;
+            }
+
+            //! Compiled breadcrumbs cache directory
+            if (option_str == "--cache-dir")
+            {
+                static const std::string CacheDirOptionName = "cache-dir";
+
+                if (parsed_options.contains(CacheDirOptionName))
+                    throw std::runtime_error(("Option '" + CacheDirOptionName + "' has been specified multiple times").c_str());
+                parsed_options.insert(CacheDirOptionName);
+
+                settings.cache_dir = ReadPathParam(argv, index++, CacheDirOptionName);
+                continue;
+            }
 
             //! Environment variables
             if (option_str == "-e" || option_str == "--env")
@@ -111,7 +240,7 @@ namespace Hansel
                 static const std::string EnvOptionName = "env";
 
                 if (parsed_options.contains(EnvOptionName))
-                    throw std::exception(("Option '" + EnvOptionName + "' has been specified multiple times").c_str());
+                    throw std::runtime_error(("Option '" + EnvOptionName + "' has been specified multiple times").c_str());
                 parsed_options.insert(EnvOptionName);
 
                 while (index < argc)
@@ -123,7 +252,7 @@ namespace Hansel
                     const std::pair<std::string, std::string> variable_pair = ReadEnvironmentVariable(argv, index++);
 
                     if (settings.variables.contains(variable_pair.first))
-                        throw std::exception(("Variable '" + variable_pair.first + "' has been already defined").c_str());
+                        throw std::runtime_error(("Variable '" + variable_pair.first + "' has been already defined").c_str());
 
                     settings.variables.insert(variable_pair);
                 }
@@ -145,6 +274,10 @@ namespace Hansel
             }
         }
 
+        // Files placed from the content store are copies, which can't be combined with links to their sources
+        if (!settings.store_dir.empty() && settings.link_mode != Settings::LinkMode::Copy)
+            throw std::runtime_error("Option 'store' can only be used with the 'copy' link mode");
+
         // Print a summary of the execution settings in verbose mode
         if (settings.verbose)
             PrintSettings(settings);
@@ -167,29 +300,26 @@ namespace Hansel
             const std::filesystem::path value_path(value_str);
             return std::filesystem::absolute(value_path.lexically_normal()).string();
         }
-        catch (std::exception)
+        catch (const std::exception&)
         {
             const std::string error = "\'" + value_str + "\' is not a valid \'" + name + "\' path";
-            throw std::exception(error.c_str());
+            throw std::runtime_error(error.c_str());
         }
     }
 
     uint32_t SettingsParser::ReadUInt32Param(const char* const argv[], const int index, const std::string& name)
     {
         const std::string value_str = std::string(argv[index]);
-        try
-        {
-            int value_int = std::stoi(value_str);
-            if (value_int <= 0)
-                throw std::exception();
 
-            return uint32_t(value_int);
-        }
-        catch (std::exception)
+        // The whole value must be a positive number (e.g. '0' or '4x' are not valid thread counts)
+        uint32_t value = 0;
+        const auto [end, err] = std::from_chars(value_str.data(), value_str.data() + value_str.size(), value);
+        if (err != std::errc() || end != value_str.data() + value_str.size() || value == 0)
         {
             const std::string error = "\'" + value_str + "\' is not a valid value for \'" + name + '\'';
-            throw std::exception(error.c_str());
+            throw std::runtime_error(error.c_str());
         }
+        return value;
     }
 
     template<typename T>
@@ -202,7 +332,31 @@ namespace Hansel
             return it->second;
 
         const std::string error = '\'' + value_str + "\' is not a valid value for \'" + name + '\'';
-        throw std::exception(error.c_str());
+        throw std::runtime_error(error.c_str());
+    }
+
+    std::vector<Platform> SettingsParser::ReadPlatformListParam(const char* const argv[], const int index, const std::string& name)
+    {
+        // Multiple platforms can be specified as a comma-separated list (e.g. win64,win64d,linux64)
+        const std::vector<std::string> platform_strings = Utilities::SplitString(ReadStringParam(argv, index, name), ',');
+
+        std::vector<Platform> platforms;
+        for (const std::string& platform_str : platform_strings)
+        {
+            const auto it = StringToPlatformMapping.find(Utilities::TrimString(platform_str));
+            if (it == StringToPlatformMapping.end())
+            {
+                const std::string error = '\'' + platform_str + "\' is not a valid value for \'" + name + '\'';
+                throw std::runtime_error(error.c_str());
+            }
+
+            if (std::find(platforms.begin(), platforms.end(), it->second) != platforms.end())
+                throw std::runtime_error(("Platform '" + it->first + "' has been specified multiple times").c_str());
+
+            platforms.push_back(it->second);
+        }
+
+        return platforms;
     }
 
     std::string SettingsParser::ReadOptionSpecifier(const char* const argv[], const int index)
@@ -210,7 +364,7 @@ namespace Hansel
         const std::string option_str = std::string(argv[index]);
 
         if (!(option_str.starts_with("--") || option_str.starts_with('-')))
-            throw std::exception("Option specifiers must begin with '-' or '--' (e.g. --verbose)");
+            throw std::runtime_error("Option specifiers must begin with '-' or '--' (e.g. --verbose)");
 
         return option_str;
     }
@@ -227,11 +381,11 @@ namespace Hansel
 
         // Check correctness of the variable definition
         if (variable_str.find('$') != std::string::npos)
-            throw std::exception("Env. variable definitions must not contain the '$' character");
+            throw std::runtime_error("Env. variable definitions must not contain the '$' character");
         if (variable_str.find('(') != std::string::npos || variable_str.find(')') != std::string::npos)
-            throw std::exception("Env. variable definitions must not contain the '(' or ')' characters");
+            throw std::runtime_error("Env. variable definitions must not contain the '(' or ')' characters");
         if (!std::regex_match(variable_str, variable_regex))
-            throw std::exception(("Env. variable definition '" + variable_str + "' is not in a valid format").c_str());
+            throw std::runtime_error(("Env. variable definition '" + variable_str + "' is not in a valid format").c_str());
 
         // Parse NAME=VALUE into std::pair and return
         const size_t splitpos = variable_str.find('=');
@@ -250,21 +404,47 @@ namespace Hansel
             case Settings::Mode::Debug:   mode = "Debug";   break;
             case Settings::Mode::List:    mode = "List";    break;
             case Settings::Mode::Check:   mode = "Check";   break;
-            default: throw std::exception("Unknown execution mode");
+            default: throw std::runtime_error("Unknown execution mode");
+        }
+
+        std::string link_mode;
+        switch (settings.link_mode)
+        {
+            case Settings::LinkMode::Copy:     link_mode = "Copy";     break;
+            case Settings::LinkMode::Hardlink: link_mode = "Hardlink"; break;
+            case Settings::LinkMode::Symlink:  link_mode = "Symlink";  break;
+            case Settings::LinkMode::Auto:     link_mode = "Auto";     break;
         }
 
         std::stringstream environment;
         for (const auto entry : settings.variables)
             environment << "\n        - " << entry.first << " = " << entry.second;
 
+        std::stringstream platforms;
+        for (size_t i = 0; i < settings.platforms.size(); i++)
+            platforms << (i > 0 ? ", " : "") << settings.platforms[i].ToString();
+
         std::stringstream message;
         message << "Hansel execution settings:"
             << "\n    - Mode: " << mode
             << "\n    - Target: '" << settings.target << "'"
             << (settings.mode != Settings::Mode::List ?
                "\n    - Output path: '" + settings.output + "'" : "")
-            << "\n    - Platform: " << settings.platform.ToString()
+            << "\n    - Platform: " << platforms.str()
             << "\n    - Environment variables:" << environment.str()
+            << "\n    - Jobs: " << settings.jobs
+            << (!settings.cache_dir.empty() ?
+               "\n    - Cache directory: '" + settings.cache_dir + "'" : "")
+            << (settings.mode == Settings::Mode::Install ?
+               "\n    - Link mode: " + link_mode : "")
+            << (settings.mode == Settings::Mode::Install && !settings.store_dir.empty() ?
+               "\n    - Content store: '" + settings.store_dir + "'" : "")
+            << (settings.io_uring_depth > 0 ?
+               "\n    - io_uring queue depth: " + std::to_string(settings.io_uring_depth) : "")
+            << (settings.max_procs > 1 ?
+               "\n    - Max processes: " + std::to_string(settings.max_procs) : "")
+            << (settings.force ? "\n    - Force: Yes" : "")
+            << (settings.prune ? "\n    - Prune: Yes" : "")
             << "\n    - Verbose: " << (settings.verbose ? "Yes" : "No")
             << std::endl;
 
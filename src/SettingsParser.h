@@ -19,6 +19,7 @@ namespace Hansel
         inline static uint32_t ReadUInt32Param(const char* const argv[], const int index, const std::string& name);
         template<typename T>
         inline static T ReadSpecialParam(const char* const argv[], const int index, const std::string& name, const std::map<std::string, T> values);
+        inline static std::vector<Platform> ReadPlatformListParam(const char* const argv[], const int index, const std::string& name);
         inline static std::string ReadOptionSpecifier(const char* const argv[], const int index);
         inline static std::pair<std::string, std::string> ReadEnvironmentVariable(const char* const argv[], const int index);
 
@@ -28,5 +29,6 @@ namespace Hansel
         // Keywords mapping for the execution mode and the platform specifier string 
         static const std::map<std::string, Settings::Mode> StringToModeMapping;
         static const std::map<std::string, Platform> StringToPlatformMapping;
+        static const std::map<std::string, Settings::LinkMode> StringToLinkModeMapping;
     };
 }
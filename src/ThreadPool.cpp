@@ -0,0 +1,131 @@
+#include "ThreadPool.h"
+
+
+namespace Hansel
+{
+    ThreadPool::ThreadPool(uint32_t thread_count)
+    {
+        for (uint32_t i = 0; i <= thread_count; i++)
+            queues.push_back(std::make_unique<TaskQueue>());
+
+        for (uint32_t i = 0; i < thread_count; i++)
+            workers.emplace_back(&ThreadPool::WorkerLoop, this, size_t(i));
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(wakeup_mutex);
+            stopping = true;
+        }
+        wakeup_condition.notify_all();
+
+        for (std::thread& worker : workers)
+            worker.join();
+    }
+
+    void ThreadPool::ParallelFor(ThreadPool* thread_pool, size_t count, const std::function<void(size_t)>& function)
+    {
+        if (!thread_pool)
+        {
+            for (size_t i = 0; i < count; i++)
+                function(i);
+            return;
+        }
+
+        std::vector<std::future<void>> futures;
+        futures.reserve(count);
+        for (size_t i = 0; i < count; i++)
+            futures.push_back(thread_pool->Submit([&function, i]() { function(i); }));
+        for (const std::future<void>& future : futures)
+            thread_pool->Wait(future);
+    }
+
+
+    void ThreadPool::Push(std::function<void()> task)
+    {
+        TaskQueue& queue = *queues[GetCurrentQueueIndex()];
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+        }
+
+        bool has_waiting_threads;
+        {
+            std::lock_guard<std::mutex> lock(wakeup_mutex);
+            pending_tasks++;
+            has_waiting_threads = (waiting_threads > 0);
+        }
+        wakeup_condition.notify_one();
+        if (has_waiting_threads)
+            progress_condition.notify_all();
+    }
+
+    bool ThreadPool::RunPendingTask()
+    {
+        const size_t own_index = GetCurrentQueueIndex();
+
+        std::function<void()> task;
+
+        // Pop the most recent task from the queue of the current thread (LIFO keeps the working set hot)
+        {
+            TaskQueue& queue = *queues[own_index];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty())
+            {
+                task = std::move(queue.tasks.back());
+                queue.tasks.pop_back();
+            }
+        }
+
+        // Otherwise steal the oldest task from one of the other queues
+        for (size_t i = 1; !task && i < queues.size(); i++)
+        {
+            TaskQueue& queue = *queues[(own_index + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (!queue.tasks.empty())
+            {
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+            }
+        }
+
+        if (!task)
+            return false;
+
+        pending_tasks--;
+        task();
+
+        // The future of the task is ready, wake up the threads which may be waiting for it
+        bool has_waiting_threads;
+        {
+            std::lock_guard<std::mutex> lock(wakeup_mutex);
+            has_waiting_threads = (waiting_threads > 0);
+        }
+        if (has_waiting_threads)
+            progress_condition.notify_all();
+        return true;
+    }
+
+    void ThreadPool::WorkerLoop(size_t queue_index)
+    {
+        s_CurrentPool = this;
+        s_CurrentQueueIndex = queue_index;
+
+        while (true)
+        {
+            if (RunPendingTask())
+                continue;
+
+            std::unique_lock<std::mutex> lock(wakeup_mutex);
+            wakeup_condition.wait(lock, [this]() { return stopping || pending_tasks > 0; });
+            if (stopping)
+                return;
+        }
+    }
+
+    size_t ThreadPool::GetCurrentQueueIndex() const
+    {
+        return (s_CurrentPool == this) ? s_CurrentQueueIndex : queues.size() - 1;
+    }
+}
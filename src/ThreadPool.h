@@ -0,0 +1,98 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+
+namespace Hansel
+{
+    class ThreadPool
+    {
+    public:
+
+        /* Creates a pool with the given number of worker threads.
+           Every worker owns a task queue, from which it pops the most recently pushed task,
+            and steals the oldest tasks from the other queues when its own queue is empty. */
+        explicit ThreadPool(uint32_t thread_count);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        uint32_t GetThreadCount() const { return uint32_t(workers.size()); }
+
+        /* Schedules the execution of 'function' on the pool and returns the future holding its result.
+           Tasks submitted from a worker thread are pushed to that worker's own queue. */
+        template<typename F>
+        auto Submit(F&& function) -> std::future<std::invoke_result_t<F>>
+        {
+            using Result = std::invoke_result_t<F>;
+
+            auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(function));
+            std::future<Result> future = task->get_future();
+            Push([task]() { (*task)(); });
+            return future;
+        }
+
+        /* Blocks until the given future (or shared_future) is ready.
+           While waiting, the calling thread executes pending tasks instead of sitting idle,
+            which also guarantees progress when tasks wait for the completion of other tasks. */
+        template<typename Future>
+        void Wait(const Future& future)
+        {
+            const auto is_ready = [&future]() { return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready; };
+            while (!is_ready())
+            {
+                if (RunPendingTask())
+                    continue;
+
+                // Sleep until a task completes (possibly this one) or a new task is queued
+                std::unique_lock<std::mutex> lock(wakeup_mutex);
+                waiting_threads++;
+                progress_condition.wait(lock, [this, &is_ready]() { return pending_tasks > 0 || is_ready(); });
+                waiting_threads--;
+            }
+        }
+
+        // Runs function(i) for each i in [0, count) and waits for all of them, serially if there is no pool
+        static void ParallelFor(ThreadPool* thread_pool, size_t count, const std::function<void(size_t)>& function);
+
+    private:
+
+        struct TaskQueue
+        {
+            std::mutex mutex;
+            std::deque<std::function<void()>> tasks;
+        };
+
+        void Push(std::function<void()> task);
+        bool RunPendingTask();
+        void WorkerLoop(size_t queue_index);
+
+        size_t GetCurrentQueueIndex() const;
+
+        // One queue per worker, plus a shared queue (the last one) for tasks submitted by external threads
+        std::vector<std::unique_ptr<TaskQueue>> queues;
+        std::vector<std::thread> workers;
+
+        std::mutex wakeup_mutex;
+        std::condition_variable wakeup_condition;
+        std::condition_variable progress_condition;     // signalled for the threads blocked in Wait()
+        size_t waiting_threads = 0;
+        std::atomic<size_t> pending_tasks = 0;
+        bool stopping = false;
+
+        // Identifies the pool (and queue) owned by the current worker thread, if any
+        inline static thread_local const ThreadPool* s_CurrentPool = nullptr;
+        inline static thread_local size_t s_CurrentQueueIndex = 0;
+    };
+}
@@ -18,6 +18,9 @@ namespace Hansel
     using Path = std::string;
     using Environment = std::map<std::string, std::string>;
 
+    // Set of target platforms, where each bit corresponds to an entry of Settings::platforms
+    using PlatformMask = uint32_t;
+
     template<class E>
     concept Enum = std::is_enum<E>::value;
 
@@ -54,6 +57,8 @@ namespace Hansel
         Architecture arch;
         Configuration config;
 
+        auto operator<=>(const Platform& other) const = default;
+
         std::string ToString() const
         {
             std::stringstream stream;
@@ -127,24 +132,34 @@ namespace Hansel
             List
         };
 
+        // How the files are installed in the output directory
+        enum class LinkMode
+        {
+            Copy,
+            Hardlink,
+            Symlink,
+            Auto        // hard links, or copies where they can't be created (e.g. across file systems)
+        };
+
         Mode mode;
         Path target;
         Path output;
         Platform platform;
+        std::vector<Platform> platforms;    // all target platforms (the first one is also stored in 'platform')
         Environment variables;
+        Path cache_dir;
+        uint32_t jobs = 1;
+        LinkMode link_mode = LinkMode::Copy;
+        uint32_t io_uring_depth = 0;        // 0 if io_uring is not used
+        Path store_dir;                     // empty if files are not installed through a content store
+        uint32_t max_procs = 1;             // commands and scripts which can run at the same time
+        bool force = false;
+        bool prune = false;
         bool verbose = false;
 
-        inline String GetTargetBreadcrumbFilename() const
-        {
-            const std::filesystem::path target_file_path = std::filesystem::canonical(target);
-            return target_file_path.filename().string();
-        }
-
-        inline Path GetTargetDirectoryPath() const
-        {
-            const std::filesystem::path target_file_path = std::filesystem::canonical(target);
-            return target_file_path.parent_path().string();
-        }
+        // The canonical target path is resolved through the FileSystemCache, like the parse contexts do
+        String GetTargetBreadcrumbFilename() const;
+        Path GetTargetDirectoryPath() const;
     };
 
 
@@ -1,11 +1,25 @@
 #pragma once
 
 #include "Types.h"
-
-#include "glob/glob.hpp"
+#include "DirectoryIndex.h"
+#include "DirectoryStream.h"
+#include "FileCopier.h"
+#include "FileSystemCache.h"
+#include "Logger.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+
+#ifdef _WIN32
+    #include <process.h>
+#else
+    #include <unistd.h>
+#endif
 
 
 namespace Hansel
@@ -57,6 +71,19 @@ namespace Hansel
             return str_copy;
         }
 
+        /* Returns the 64-bit FNV-1a hash of the provided string.
+           The hash is stable across executions, therefore it can be used for naming persistent files. */
+        static uint64_t HashString(const std::string& str)
+        {
+            uint64_t hash = 14695981039346656037ull;
+            for (const char c : str)
+            {
+                hash ^= uint64_t(static_cast<unsigned char>(c));
+                hash *= 1099511628211ull;
+            }
+            return hash;
+        }
+
         /* Returns an array of sub-strings, obtained by splitting the provided
             string at every occurrence of the <delimiter> character.
            The delimiter is not included in the sub-strings. */
@@ -85,7 +112,7 @@ namespace Hansel
                     return false;
                 return std_path.is_relative();
             }
-            catch (std::exception)
+            catch (const std::exception&)
             {
                 return false;
             }
@@ -120,11 +147,11 @@ namespace Hansel
         static std::optional<Path> ResolvePath(const Path& relative_path, const std::vector<Path>& root_paths)
         {
             // Attempt all provided root paths, returning the first match with an existing filesystem path
+            // NOTE: the same roots are probed for many different dependencies, their contents are indexed on first use
             for (size_t i = 0; i < root_paths.size(); i++)
             {
-                Path combined_path = Utilities::CombinePath(root_paths[i], relative_path);
-                if (std::filesystem::exists(combined_path))
-                    return combined_path;
+                if (DirectoryIndex::Exists(root_paths[i], relative_path))
+                    return Utilities::CombinePath(root_paths[i], relative_path);
             }
             return std::optional<Path>(std::nullopt);
         }
@@ -140,6 +167,45 @@ namespace Hansel
                 CombinePath(root, path);
         }
 
+        /* Returns the normalized form of a path (lexically normal, with '/' separators and no trailing one,
+            in lowercase on Windows), under which the different spellings of a path compare equal. */
+        static Path GetPathKey(const Path& path)
+        {
+            Path path_key = std::filesystem::path(path).lexically_normal().generic_string();
+            while (path_key.size() > 1 && path_key.ends_with('/'))
+                path_key.pop_back();
+#ifdef _WIN32
+            path_key = LowerString(path_key);
+#endif
+            return path_key;
+        }
+
+        // Size and modification time of a file, which tell whether it has changed since they were recorded
+        struct FileInfo
+        {
+            uint64_t size = 0;
+            int64_t  modification_time = 0;
+
+            auto operator<=>(const FileInfo& other) const = default;
+        };
+
+        // Returns the size and modification time of a file, or an empty optional if it can't be read
+        static std::optional<FileInfo> GetFileInfo(const Path& path)
+        {
+            std::error_code err;
+            const std::filesystem::path file_path(path);
+
+            const uint64_t size = std::filesystem::file_size(file_path, err);
+            if (err.value() != 0)
+                return {};
+
+            const std::filesystem::file_time_type modification_time = std::filesystem::last_write_time(file_path, err);
+            if (err.value() != 0)
+                return {};
+
+            return FileInfo{ size, int64_t(modification_time.time_since_epoch().count()) };
+        }
+
         /* Construct the destination path of a file by combining the destination
             directory path with the last part of the source file path (which could be
             just the filename or a sub-path relative to <source_dir>).
@@ -160,94 +226,151 @@ namespace Hansel
         {
             std::vector<Path> files;
 
-            for (auto const& dir_entry : std::filesystem::directory_iterator{ directory })
+            // A single depth-first walk, so that the files of sub-directories don't need to be collected separately
+            const std::filesystem::recursive_directory_iterator directory_it{ directory,
+                std::filesystem::directory_options::follow_directory_symlink };
+            for (auto const& dir_entry : directory_it)
             {
                 if (dir_entry.is_regular_file())
-                {
                     files.push_back(dir_entry.path().string());
-                }
-                else if (dir_entry.is_directory())
-                {
-                    std::vector<Path> subdir_files = GetAllFilesInDirectory(dir_entry.path().string());
-                    files.insert(files.end(), subdir_files.begin(), subdir_files.end());
-                }
             }
 
             return files;
         }
 
-        /* Returns a list of all absolute file paths that match with the provided pattern.
-           The pattern matching is done according to Unix-style pathname pattern expansion, also known as globbing.
-           For more details about the pattern syntax and glob wildcards refer to:
-            https://github.com/p-ranav/glob/blob/master/README.md#wildcards */
-        static std::vector<Path> GlobFiles(const String& pattern)
-        {
-            std::vector<Path> files;
+        using CopyFileFunction = std::function<std::error_code(const Path& from, const Path& to)>;
 
-            const std::filesystem::path directory = std::filesystem::path(pattern).parent_path();
-            const std::string glob_pattern = std::filesystem::path(pattern).filename().string();
+        /* Recursively copies the source directory and all of its contents into the target directory path. 
+           The copy operation overwrites any existing file or directory in the target path, unless a different
+            'copy_file' function is provided (which is then called for each file in place of FileCopier::Copy()).
+           Entries are copied as soon as they are enumerated, without listing the whole directory first. */
+        static std::error_code CopyDirectory(const Path& from, const Path& to, const CopyFileFunction& copy_file = {})
+        {
+            // Make sure that the target path exists before copying to it
+            std::error_code err;
+            std::filesystem::create_directories(std::filesystem::path(to), err);
+            if (err.value() != 0)
+                return err;
 
-            for (auto const& dir_entry : std::filesystem::directory_iterator{ directory })
+            DirectoryStream stream(from);
+            while (const std::optional<DirectoryStream::Entry> entry = stream.Next())
             {
-                if (glob::fnmatch_case(dir_entry.path(), glob_pattern))
+                const std::filesystem::path entry_destination = GetDestinationPath(to, entry->path, from);
+                if (entry->is_directory)
+                {
+                    // The parent directory has always been enumerated (and created) before its entries
+                    std::filesystem::create_directory(entry_destination, err);
+                }
+                else if (copy_file)
                 {
-                    if (dir_entry.is_regular_file())
-                    {
-                        files.push_back(dir_entry.path().string());
-                    }
-                    else if (dir_entry.is_directory())
-                    {
-                        std::vector<Path> subdir_files = GetAllFilesInDirectory(dir_entry.path().string());
-                        files.insert(files.end(), subdir_files.begin(), subdir_files.end());
-                    }
+                    err = copy_file(entry->path, entry_destination.string());
                 }
+                else
+                {
+                    err = FileCopier::Copy(entry->path, entry_destination.string());
+                }
+
+                if (err.value() != 0)
+                    return err;
             }
 
-            return files;
+            return stream.GetError();
         }
 
-
-        /* Recursively copies the source directory and all of its contents into the target directory path. 
-           The copy operation overwrites any existing file or directory in the target path. */
-        static std::error_code CopyDirectory(const Path& from, const Path& to)
+        /* Creates an empty temporary file next to 'path' (to be moved over it once written), whose name is unique
+            among all the threads and processes: it's made of the process id and a counter, and the file is created
+            exclusively so that a name which is already taken is never reused. Returns an empty path on errors. */
+        static Path CreateTemporaryFile(const Path& path, std::error_code& err)
         {
-            const std::filesystem::copy_options options =
-                std::filesystem::copy_options::overwrite_existing |
-                std::filesystem::copy_options::recursive;
+#ifdef _WIN32
+            const int process_id = _getpid();
+#else
+            const int process_id = int(getpid());
+#endif
+            static std::atomic<uint32_t> counter = 0;
+            for (uint32_t attempt = 0; attempt < 100; attempt++)
+            {
+                const Path temporary_path = path + ".tmp" + std::to_string(process_id) + '-' + std::to_string(counter++);
+                if (std::FILE* file = std::fopen(temporary_path.c_str(), "wbx"))
+                {
+                    std::fclose(file);
+                    err.clear();
+                    return temporary_path;
+                }
 
-            // Make sure that the target path exists before copying to it
+                err = std::error_code(errno, std::generic_category());
+                if (err != std::errc::file_exists)
+                    return {};
+            }
+            return {};
+        }
+
+        /* Replaces the content of the file with 'content', which is written to a temporary file first (see
+            CreateTemporaryFile()) and then moved in place, so that an interrupted (or concurrent) execution never
+            leaves a partially written file behind. The parent directories are created if necessary. */
+        static std::error_code WriteFileAtomically(const Path& path, std::string_view content)
+        {
             std::error_code err;
-            std::filesystem::create_directories(std::filesystem::path(to), err);
-            if (err.value() != 0)
+            std::filesystem::create_directories(std::filesystem::path(path).parent_path(), err);
+
+            const Path temporary_path = CreateTemporaryFile(path, err);
+            if (temporary_path.empty())
                 return err;
 
-            std::filesystem::copy(std::filesystem::path(from), std::filesystem::path(to), options, err);
+            {
+                std::ofstream stream(temporary_path, std::ios::binary | std::ios::trunc);
+                stream.write(content.data(), std::streamsize(content.size()));
+                stream.close();
+                if (!stream)
+                {
+                    std::filesystem::remove(temporary_path, err);
+                    return std::make_error_code(std::errc::io_error);
+                }
+            }
+
+            std::filesystem::rename(temporary_path, path, err);
+            if (err.value() != 0)
+            {
+                std::error_code remove_err;
+                std::filesystem::remove(temporary_path, remove_err);
+            }
             return err;
         }
 
-        /* Recursively copies the specified file into the target directory path.
-           The copy operation overwrites any existing file with the same name in the target path. */
-        static std::error_code CopySingleFile(const Path& from, const Path& to)
+        using ParseLineFunction = std::function<bool(const std::vector<std::string>& fields)>;
+
+        /* Reads a text file written by Hansel (e.g. the install manifest), whose first line must be 'header' (which
+            identifies the version of its layout), and passes the tab-separated fields of each of the other lines to
+            'parse_line'. Returns false if the file has another header or if 'parse_line' rejects one of its lines,
+            warning that the file (named by 'description') will be re-generated; a missing file is not an error. */
+        static bool ReadVersionedFile(const Path& path, std::string_view header, const char* description,
+            const ParseLineFunction& parse_line)
         {
-            const std::filesystem::copy_options options =
-                std::filesystem::copy_options::overwrite_existing;
+            std::ifstream stream(path);
+            if (!stream)
+                return true;
 
-            // Make sure that the target path exists before copying to it
-            std::error_code err;
-            std::filesystem::create_directories(std::filesystem::path(to), err);
-            if (err.value() != 0)
-                return err;
+            std::string line;
+            if (!std::getline(stream, line) || line != header)
+            {
+                Logger::WarnVerbose("The {} '{}' is not valid and will be re-generated", description, path);
+                return false;
+            }
 
-            std::filesystem::copy(std::filesystem::path(from), std::filesystem::path(to), options, err);
-            return err;
+            while (std::getline(stream, line))
+            {
+                if (!parse_line(SplitString(line, '\t')))
+                {
+                    Logger::WarnVerbose("The {} '{}' is corrupted and will be re-generated", description, path);
+                    return false;
+                }
+            }
+            return true;
         }
 
-        /* Copy all of the files that match with the given pattern into the specified target.
-           The pattern matching is done according to Unix-style pathname pattern expansion, also known as globbing.
-           For more details about the pattern syntax and glob wildcards refer to:
-            https://github.com/p-ranav/glob/blob/master/README.md#wildcards
+        /* Recursively copies the specified file into the target directory path.
            The copy operation overwrites any existing file with the same name in the target path. */
-        static std::error_code CopyMultipleFiles(const String& from_pattern, const Path& to)
+        static std::error_code CopySingleFile(const Path& from, const Path& to)
         {
             // Make sure that the target path exists before copying to it
             std::error_code err;
@@ -255,30 +378,7 @@ namespace Hansel
             if (err.value() != 0)
                 return err;
 
-            const std::filesystem::path from_directory = std::filesystem::path(from_pattern).parent_path();
-            const std::string glob_pattern = std::filesystem::path(from_pattern).filename().string();
-
-            for (auto const& dir_entry : std::filesystem::directory_iterator{ from_directory })
-            {
-                if (glob::fnmatch_case(dir_entry.path(), glob_pattern))
-                {
-                    if (dir_entry.is_regular_file())
-                    {
-                        const std::filesystem::path& file_path = dir_entry.path();
-                        err = CopySingleFile(file_path.string(), to);
-                    }
-                    else if (dir_entry.is_directory())
-                    {
-                        const std::filesystem::path& directory_path = dir_entry.path();
-                        const std::filesystem::path& to_directory_path = std::filesystem::path(to) / dir_entry.path().filename();
-                        err = CopyDirectory(dir_entry.path().string(), to_directory_path.string());
-                    }
-                    if (err.value() != 0)
-                        return err;
-                }
-            }
-
-            return err;
+            return FileCopier::Copy(from, (std::filesystem::path(to) / std::filesystem::path(from).filename()).string());
         }
 	}
 }
\ No newline at end of file
@@ -3,35 +3,60 @@
 #include "SettingsParser.h"
 #include "Dependencies.h"
 #include "Parser.h"
+#include "CommandStamps.h"
+#include "CompiledBreadcrumbCache.h"
+#include "ContentStore.h"
+#include "DirectoryIndex.h"
+#include "ExpansionCache.h"
+#include "FileCopier.h"
+#include "FileSystemCache.h"
+#include "InstallManifest.h"
+#include "PathPattern.h"
 #include "DependencyChecker.h"
 
+#include <stdexcept>
+
 using namespace Hansel;
 
 
 /** The Hansel tool is designed to be used in three possible ways:
 
-    1) hansel.exe --install <path-to-breadcrumb> <install-dir> <platform-specifier> [--env <variables>] [-v,--verbose]
+    1) hansel.exe --install <path-to-breadcrumb> <install-dir> <platform-specifier> [--env <variables>] [-j,--jobs <N>] [--link-mode <mode>] [--io-uring <depth>] [--store <path>] [--max-procs <N>] [--force] [--prune] [-v,--verbose]
 
     Running Hansel in its standard form will act as an 'install' step
     after the target build process has finished. It will take care of
     copying the specified dependencies and resources to the output
     folder, running additional scripts (if specified), trying to
     automatically resolve paths and potential library conflicts.
-
-    2) hansel.exe --debug <path-to-breadcrumb> <install-dir> <platform-specifier> [--env <variables>] [-v,--verbose]
+    Files which haven't changed since the previous installation are
+    not copied again, unless the '--force' option is specified; the same
+    holds for the commands and scripts which declare their inputs and outputs.
+    With '--link-mode', files can be installed as hard or symbolic links
+    to their sources instead of copies (e.g. for local development builds).
+    With '--prune', the files left in the output folder by a previous
+    installation which are not installed anymore are removed.
+    On Linux, '--io-uring' copies small files in batches through io_uring,
+    submitting up to the given number of requests at once.
+    With '--store', files are installed through a content-addressed store
+    shared by all workspaces, which keeps a single copy of each file and
+    places it in the output folder by reflink or hard link.
+    With '--max-procs', up to N commands and scripts of independent
+    libraries and projects are executed at the same time.
+
+    2) hansel.exe --debug <path-to-breadcrumb> <install-dir> <platform-specifier> [--env <variables>] [-j,--jobs <N>] [-v,--verbose]
 
     In debug mode, Hansel will 'simulate' the --install mode execution,
     printing all the operations that it would normally perform, to let
     the user observe its behaviour, without actually modifying the filesystem.
 
-    3) hansel.exe --check <path-to-breadcrumb> <install-dir> <platform-specifier> [--env <variables>] [-v,--verbose]
+    3) hansel.exe --check <path-to-breadcrumb> <install-dir> <platform-specifier> [--env <variables>] [-j,--jobs <N>] [-v,--verbose]
 
     When launched with the 'check' option, Hansel does not perform any
     build step but is able to analyze the dependency tree of the target
     and detect any error of missing library folders, conflicts between
     library versions, wrong paths and so on...
 
-    4) hansel.exe --list <path-to-breadcrumb> <platform-specifier> [--env <variables>] [-v,--verbose]
+    4) hansel.exe --list <path-to-breadcrumb> <platform-specifier> [--env <variables>] [-j,--jobs <N>] [-v,--verbose]
 
     In 'list' mode, Hansel traverses the dependency tree of the specified
     target and prints it in a clear and understandable format in the
@@ -57,7 +82,7 @@ int main(int argc, char* argv[])
     {
         settings = SettingsParser::ParseCommandLine(argc, argv);
     }
-    catch (std::exception e)
+    catch (const std::exception& e)
     {
         Logger::Error("{}", e.what());
 
@@ -66,15 +91,19 @@ int main(int argc, char* argv[])
         return EXIT_FAILURE;
     }
 
-    std::unique_ptr<RootDependency> root;
+    std::vector<Dependency*> dependencies;
     if (settings.mode != Settings::Mode::Help)
     {
         try
         {
-            std::vector<Dependency*> dependencies = Parser::ParseBreadcrumb(settings.target, settings);
-            root = std::make_unique<RootDependency>(settings.GetTargetBreadcrumbFilename(), settings.output, dependencies);
+            dependencies = Parser::ParseBreadcrumb(settings.target, settings);
+
+            if (!settings.cache_dir.empty())
+                CompiledBreadcrumbCache::PrintStatistics();
+            FileSystemCache::PrintStatistics();
+            DirectoryIndex::PrintStatistics();
         }
-        catch (std::exception e)
+        catch (const std::exception& e)
         {
             Logger::Error("{}", e.what());
 
@@ -82,39 +111,96 @@ int main(int argc, char* argv[])
         }
     }
 
-    bool success;
-    switch (settings.mode)
+    if (settings.mode == Settings::Mode::Help)
     {
-        case Settings::Mode::Help:
-        {
-            ShowHelp();
-            success = true;
-            break;
-        }
+        ShowHelp();
+        std::printf("\n");
 
-        case Settings::Mode::Install: [[fallthrough]];
-        case Settings::Mode::Debug:
-        {
-            success = root->Realize(settings.mode == Settings::Mode::Debug, settings.verbose);
-            break;
-        }
+        return EXIT_SUCCESS;
+    }
+
+    // The same number of threads is used to walk the directory trees matched by <Files> patterns
+    PathPattern::SetThreadCount(settings.jobs);
 
-        case Settings::Mode::Check:
+    // Small files are copied in batches through io_uring, if enabled
+    FileCopier::SetQueueDepth(settings.io_uring_depth);
+
+    // Files which are up-to-date since the previous installation (to the same output directory) are not copied again
+    std::unique_ptr<InstallManifest> manifest;
+    if (settings.mode == Settings::Mode::Install)
+        manifest = std::make_unique<InstallManifest>(settings.output, settings.force);
+
+    // Likewise, commands and scripts whose declared inputs haven't changed since their last successful run are skipped
+    std::unique_ptr<CommandStamps> stamps;
+    if (settings.mode == Settings::Mode::Install)
+        stamps = std::make_unique<CommandStamps>(settings.output, settings.force);
+
+    // Files can be installed through a content store shared with other workspaces, which keeps a single copy of each one
+    std::unique_ptr<ContentStore> store;
+    if (settings.mode == Settings::Mode::Install && !settings.store_dir.empty())
+        store = std::make_unique<ContentStore>(settings.store_dir);
+
+    // The dependency tree has been parsed once for all target platforms, which are then processed one at a time
+    bool success = true;
+    for (size_t platform_index = 0; platform_index < settings.platforms.size(); platform_index++)
+    {
+        const bool multiple_platforms = settings.platforms.size() > 1;
+        if (multiple_platforms)
+            Logger::Info("Processing platform '{}'", settings.platforms[platform_index].ToString());
+
+        const std::unique_ptr<RootDependency> root = std::make_unique<RootDependency>(settings.GetTargetBreadcrumbFilename(), settings.output,
+            multiple_platforms ? Dependency::SelectPlatform(dependencies, platform_index) : dependencies);
+
+        switch (settings.mode)
         {
-            success = DependencyChecker::Check(root.get(), settings);
-            break;
+            case Settings::Mode::Install: [[fallthrough]];
+            case Settings::Mode::Debug:
+            {
+                if (!root->Realize(settings.mode == Settings::Mode::Debug, settings.verbose, settings.jobs,
+                        settings.link_mode, manifest.get(), store.get(), settings.max_procs, stamps.get()))
+                    success = false;
+                break;
+            }
+
+            case Settings::Mode::Check:
+            {
+                if (!DependencyChecker::Check(root.get(), settings))
+                    success = false;
+                break;
+            }
+
+            case Settings::Mode::List:
+            {
+                root->Print({});
+                break;
+            }
+
+            default:
+                throw std::runtime_error("Unknown execution mode");
         }
+    }
 
-        case Settings::Mode::List:
+    if (manifest)
+    {
+        // Files installed by the previous executions but not by this one are removed at the end, for all platforms,
+        //  unless the installation has failed (its plan may not have been complete)
+        if (settings.prune && !success)
+            Logger::Warn("The installation has failed, stale files are not removed");
+        else if (settings.prune && !manifest->Prune(settings.jobs))
+            success = false;
+
+        manifest->Save();
+        manifest->PrintStatistics();
+        stamps->Save();
+        stamps->PrintStatistics();
+        if (store)
         {
-            root->Print({});
-            success = true;
-            break;
+            store->Save();
+            store->PrintStatistics();
         }
-
-        default:
-            throw std::exception("Unknown execution mode");
+        FileCopier::PrintStatistics();
     }
+    ExpansionCache::PrintStatistics();
 
     std::printf("\n");
 
@@ -126,10 +212,10 @@ int main(int argc, char* argv[])
 void ShowHelp()
 {
     std::printf("\nUsage:  Hansel --help"
-                "\n        Hansel --install <path-to-breadcrumb> <install-dir> <platform> [-e <variables>] [-v]"
-                "\n        Hansel --debug <path-to-breadcrumb> <install-dir> <platform> [-e <variables>] [-v]"
-                "\n        Hansel --check <path-to-breadcrumb> <install-dir> <platform> [-e <variables>] [-v]"
-                "\n        Hansel --list <path-to-breadcrumb> <platform> [-e <variables>] [-v]"
+                "\n        Hansel --install <path-to-breadcrumb> <install-dir> <platform> [-e <variables>] [-j <N>] [--link-mode <mode>] [--io-uring <depth>] [--store <path>] [--max-procs <N>] [--force] [--prune] [-v]"
+                "\n        Hansel --debug <path-to-breadcrumb> <install-dir> <platform> [-e <variables>] [-j <N>] [-v]"
+                "\n        Hansel --check <path-to-breadcrumb> <install-dir> <platform> [-e <variables>] [-j <N>] [-v]"
+                "\n        Hansel --list <path-to-breadcrumb> <platform> [-e <variables>] [-j <N>] [-v]"
                 "\n"
                 "\nModes:"
                 "\n"
@@ -148,10 +234,23 @@ void ShowHelp()
                 "\n                             xxx = { win, linux, macosx }  (OS)"
                 "\n                              YY = { 32, 64 }              (Architecture)"
                 "\n                               d = Debug flag              (Configuration)"
+                "\n                           Multiple platforms can be processed at once with a comma-separated list"
+                "\n                            of specifiers (e.g. win64,win64d), parsing breadcrumbs only once"
                 "\nOptional:"
                 "\n"
                 "\n  -e / --env <variables>  Set of environment variable definitions."
                 "\n                           A variable definition is in the format VARIABLE_NAME=value"
+                "\n  --cache-dir <path>      Directory where compiled breadcrumbs are cached, to speed up the next executions"
+                "\n  -j / --jobs <N>         Number of threads used for parsing breadcrumbs and installing files (default: 1)"
+                "\n  --link-mode <mode>      [INSTALL] How files are installed: copy (default), hardlink, symlink, or auto"
+                "\n                           (hard links, falling back to copies where they can't be created)"
+                "\n  --io-uring <depth>      [INSTALL] Copy small files in batches through io_uring (Linux only), with the given queue depth"
+                "\n  --store <path>          [INSTALL] Install files through a content-addressed store (e.g. ~/.cache/hansel/cas) shared by"
+                "\n                           all workspaces, placing them by reflink or hard link (copy link mode only)"
+                "\n  --max-procs <N>         [INSTALL] Number of commands and scripts of independent libraries and projects which can run"
+                "\n                           at the same time (default: 1)"
+                "\n  --force                 [INSTALL] Copy all files and execute all commands, including those which are up-to-date since the last install"
+                "\n  --prune                 [INSTALL] Remove the files of the previous installs which are not installed anymore"
                 "\n  -v / --verbose          Enable additional program outputs (verbose)"
                 "\n"
     );
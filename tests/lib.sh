@@ -0,0 +1,79 @@
+# Helpers shared by the tests (see run_tests.sh), which run in the directory of the test.
+
+# Runs Hansel, without the trace of the parsed breadcrumbs
+hansel()
+{
+    "$HANSEL" "$@" 2>&1 | grep -v '^\[TRACE\]'
+    return "${PIPESTATUS[0]}"
+}
+
+# Writes a breadcrumb file, with the dependency nodes read from the standard input
+#  Usage: breadcrumb <path> [<Dependencies> attributes]
+breadcrumb()
+{
+    mkdir -p "$(dirname "$1")"
+    {
+        echo '<?xml version="1.0" encoding="UTF-8"?>'
+        echo '<Breadcrumb FormatVersion="0.1">'
+        echo "  <Dependencies ${2:-}>"
+        cat
+        echo '  </Dependencies>'
+        echo '</Breadcrumb>'
+    } > "$1"
+}
+
+# Writes a file with the given content (its path by default), creating its directory
+#  Usage: make_file <path> [content]
+make_file()
+{
+    mkdir -p "$(dirname "$1")"
+    printf '%s\n' "${2:-$1}" > "$1"
+}
+
+# Prints the relative paths of all the files under a directory, sorted, with their content hash
+tree_of()
+{
+    (cd "$1" && find . -type f ! -name '.hansel-*' | LC_ALL=C sort | while read -r file; do
+        echo "$file $(cksum < "$file" | awk '{ print $1 }')"
+    done)
+}
+
+# Stops a test which can't run in this environment, the reason is reported by run_tests.sh
+skip()
+{
+    echo "$*"
+    exit 77
+}
+
+fail()
+{
+    echo "Assertion failed: $*" >&2
+    exit 1
+}
+
+assert_eq()
+{
+    [ "$1" == "$2" ] || fail "${3:-values differ}"$'\n'"  expected: '$1'"$'\n'"  actual:   '$2'"
+}
+
+assert_contains()
+{
+    [[ "$1" == *"$2"* ]] || fail "'$2' not found in the output:"$'\n'"$1"
+}
+
+assert_not_contains()
+{
+    [[ "$1" != *"$2"* ]] || fail "'$2' unexpectedly found in the output:"$'\n'"$1"
+}
+
+# Usage: assert_file <path> [content]
+assert_file()
+{
+    [ -f "$1" ] || fail "file '$1' doesn't exist"
+    [ $# -lt 2 ] || assert_eq "$2" "$(cat "$1")" "unexpected content of '$1'"
+}
+
+assert_no_file()
+{
+    [ ! -e "$1" ] || fail "'$1' exists"
+}
@@ -0,0 +1,48 @@
+#!/usr/bin/env bash
+# Regression tests of the Hansel executable: each test generates a small tree of breadcrumbs and files in
+#  a temporary directory, runs Hansel on it and checks the output and the installed files.
+# Usage: tests/run_tests.sh <path-to-hansel> [pattern]
+#  Only the tests whose name contains 'pattern' are executed, the exit code is the number of failed tests.
+
+if [ $# -lt 1 ] || [ ! -x "$1" ]; then
+    echo "Usage: $0 <path-to-hansel> [pattern]" >&2
+    exit 255
+fi
+
+HANSEL=$(cd "$(dirname "$1")" && pwd)/$(basename "$1")
+TESTS_DIR=$(cd "$(dirname "$0")" && pwd)
+
+source "$TESTS_DIR/lib.sh"
+for test_file in "$TESTS_DIR"/test_*.sh; do
+    source "$test_file"
+done
+
+passed=0
+failed=0
+skipped=0
+for test_name in $(declare -F | awk '{ print $3 }' | grep '^test_' | grep -- "${2:-}"); do
+    test_dir=$(mktemp -d)
+
+    # Tests run in a sub-shell inside their directory, assertions exit from it on failure (see lib.sh)
+    (cd "$test_dir" && "$test_name") > "$test_dir.log" 2>&1
+    case $? in
+        0)
+            echo "PASS  $test_name"
+            passed=$((passed + 1))
+            ;;
+        77)
+            echo "SKIP  $test_name ($(tail -n 1 "$test_dir.log"))"
+            skipped=$((skipped + 1))
+            ;;
+        *)
+            echo "FAIL  $test_name"
+            sed 's/^/      /' "$test_dir.log"
+            failed=$((failed + 1))
+            ;;
+    esac
+    rm -rf "$test_dir" "$test_dir.log"
+done
+
+echo
+echo "$passed passed, $failed failed, $skipped skipped"
+exit $failed
@@ -0,0 +1,78 @@
+# Execution of commands and scripts (see ProcessRunner)
+
+test_commands_run_in_order()
+{
+    breadcrumb app/app.hbc <<'HBC'
+    <Command Code="echo first" />
+    <Command Code="echo second" />
+    <Command Code="echo third &gt;&amp;2" />
+HBC
+    local output
+    output=$(hansel --install app/app.hbc out linux64 -e OUTPUT_DIR=out) || fail "install failed: $output"
+    assert_contains "$output" $'first\nsecond\nthird'
+}
+
+test_commands_stream_their_output()
+{
+    # The output of a command which runs alone is seen before it completes
+    breadcrumb app/app.hbc <<'HBC'
+    <Command Code="echo started; while [ ! -f done ]; do sleep 0.1; done" />
+HBC
+    # Not through the filter of the 'hansel' helper, which buffers its output
+    "$HANSEL" --install app/app.hbc out linux64 -e OUTPUT_DIR=out > log 2>&1 &
+    local pid=$! i
+    for i in $(seq 1 100); do
+        grep -q started log && break
+        sleep 0.1
+    done
+    grep -q started log || { touch done; wait $pid; fail "no output while the command is running: $(cat log)"; }
+    touch done
+    wait $pid || fail "install failed: $(cat log)"
+}
+
+test_commands_concurrent_outputs_are_not_interleaved()
+{
+    local library
+    for library in one two three; do
+        breadcrumb "libs/$library/1.0/$library.hbc" <<HBC
+    <Command Code="for i in 1 2 3; do echo $library-\$i; sleep 0.05; done" />
+HBC
+    done
+    breadcrumb app/app.hbc 'LibraryPath="../libs"' <<'HBC'
+    <Library Name="one" Version="1.0" Destination="$(OUTPUT_DIR)" />
+    <Library Name="two" Version="1.0" Destination="$(OUTPUT_DIR)" />
+    <Library Name="three" Version="1.0" Destination="$(OUTPUT_DIR)" />
+HBC
+    local output
+    output=$(hansel --install app/app.hbc out linux64 -e OUTPUT_DIR=out --max-procs 3) || fail "install failed: $output"
+    assert_contains "$output" $'one-1\none-2\none-3\ntwo-1\ntwo-2\ntwo-3\nthree-1\nthree-2\nthree-3'
+}
+
+test_commands_failure()
+{
+    breadcrumb app/app.hbc <<'HBC'
+    <Command Code="exit 3" />
+HBC
+    local output
+    output=$(hansel --install app/app.hbc out linux64 -e OUTPUT_DIR=out) && fail "install succeeded: $output"
+    assert_contains "$output" "Command 'exit 3' failed with exit code 3"
+}
+
+test_commands_background_processes_are_not_waited_for()
+{
+    # A command has completed once its shell has exited, even if a background process still holds its outputs
+    breadcrumb libs/one/1.0/one.hbc <<'HBC'
+    <Command Code="sleep 5 &amp; echo started-one" />
+HBC
+    breadcrumb libs/two/1.0/two.hbc <<'HBC'
+    <Command Code="echo two" />
+HBC
+    breadcrumb app/app.hbc 'LibraryPath="../libs"' <<'HBC'
+    <Library Name="one" Version="1.0" Destination="$(OUTPUT_DIR)" />
+    <Library Name="two" Version="1.0" Destination="$(OUTPUT_DIR)" />
+HBC
+    local output start=$SECONDS
+    output=$(hansel --install app/app.hbc out linux64 -e OUTPUT_DIR=out --max-procs 2) || fail "install failed: $output"
+    [ $((SECONDS - start)) -lt 4 ] || fail "the install has waited for the background process"
+    assert_contains "$output" $'started-one\ntwo'
+}
@@ -0,0 +1,25 @@
+# Compiled breadcrumbs cache (see CompiledBreadcrumbCache)
+
+test_compiled_cache_reuses_and_refreshes_breadcrumbs()
+{
+    breadcrumb libs/Lib/1.0/Lib.hbc <<'HBC'
+    <File Path="./lib.so" Destination="$(OUTPUT_DIR)" />
+HBC
+    breadcrumb app/app.hbc 'LibraryPath="../libs"' <<'HBC'
+    <Library Name="Lib" Version="1.0" Destination="$(OUTPUT_DIR)" />
+    <Command Code="echo $(MY_VAR)" />
+HBC
+    local first second
+    first=$(hansel --list app/app.hbc linux64 -e MY_VAR=yes --cache-dir cache -v) || fail "list failed: $first"
+    assert_contains "$first" "Compiled breadcrumb cache: 0 hits, 2 misses"
+
+    second=$(hansel --list app/app.hbc linux64 -e MY_VAR=yes --cache-dir cache -v) || fail "list failed: $second"
+    assert_contains "$second" "Compiled breadcrumb cache: 2 hits, 0 misses"
+    assert_eq "$(grep -F '|' <<< "$first")" "$(grep -F '|' <<< "$second")" "the cached tree is different"
+
+    # A modified breadcrumb is parsed again
+    sed -i.bak 's/echo/echo changed/' app/app.hbc
+    second=$(hansel --list app/app.hbc linux64 -e MY_VAR=yes --cache-dir cache -v) || fail "list failed: $second"
+    assert_contains "$second" "Compiled breadcrumb cache: 1 hits, 1 misses"
+    assert_contains "$second" "[COMMAND] echo changed yes"
+}
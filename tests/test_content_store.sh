@@ -0,0 +1,95 @@
+# Installation through the content-addressed store with --store (see ContentStore)
+
+# Prints the names of the objects of the store, without their permissions
+store_objects()
+{
+    (cd store/objects && find . -type f ! -name '*.tmp*' | sed 's|.*/||; s|-[0-7]*$||' | LC_ALL=C sort | xargs)
+}
+
+test_content_store_sha256_known_answers()
+{
+    mkdir -p app/bin
+    printf '' > app/bin/empty
+    printf 'abc' > app/bin/abc
+    printf 'abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq' > app/bin/two_blocks
+    head -c 1000000 /dev/zero | tr '\0' 'a' > app/bin/million
+    breadcrumb app/app.hbc <<'HBC'
+    <Files Path="./bin/*" Destination="$(OUTPUT_DIR)" />
+HBC
+    local output
+    output=$(hansel --install app/app.hbc out linux64 -e OUTPUT_DIR=out --store store) || fail "install failed: $output"
+
+    # Test vectors of FIPS 180-2
+    assert_eq "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1 \
+ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad \
+cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0 \
+e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" "$(store_objects)"
+    assert_file out/linux64/abc abc
+    cmp app/bin/million out/linux64/million || fail "the installed copy of 'million' differs"
+}
+
+test_content_store_reuses_objects()
+{
+    make_file app/bin/a.so "same"
+    make_file app/other/a.so "same"
+    breadcrumb app/app.hbc <<'HBC'
+    <File Path="./bin/a.so" Destination="$(OUTPUT_DIR)/first" />
+    <File Path="./other/a.so" Destination="$(OUTPUT_DIR)/second" />
+HBC
+    local output
+    output=$(hansel --install app/app.hbc out linux64 -e OUTPUT_DIR=out --store store -v -j 1) || fail "install failed: $output"
+    assert_contains "$output" "1 objects added and 1 reused"
+    assert_file out/linux64/first/a.so same
+    assert_file out/linux64/second/a.so same
+
+    # No temporary file is left in the store
+    assert_eq "" "$(find store -name '*.tmp*')"
+}
+
+test_content_store_source_changed_with_same_info()
+{
+    make_file app/bin/a.so "aaaa"
+    breadcrumb app/app.hbc <<'HBC'
+    <File Path="./bin/a.so" Destination="$(OUTPUT_DIR)" />
+HBC
+    local output
+    output=$(hansel --install app/app.hbc out linux64 -e OUTPUT_DIR=out --store store) || fail "install failed: $output"
+
+    # Same size and modification time, but a different content: the recorded hash is wrong, the
+    #  new object must not be stored under it
+    rm -rf store/objects out
+    touch -r app/bin/a.so reference
+    printf 'bbbb\n' > app/bin/a.so
+    touch -r reference app/bin/a.so
+    output=$(hansel --install app/app.hbc out linux64 -e OUTPUT_DIR=out --store store) || fail "install failed: $output"
+    assert_file out/linux64/a.so bbbb
+    assert_eq "" "$(store_objects)"
+
+    # The source is hashed again by the next installation
+    output=$(hansel --install app/app.hbc out linux64 -e OUTPUT_DIR=out --store store --force) || fail "install failed: $output"
+    assert_eq "$(printf 'bbbb\n' | sha256sum | cut -d ' ' -f 1)" "$(store_objects)"
+}
+
+test_content_store_concurrent_processes()
+{
+    local i
+    mkdir -p app/bin
+    for i in $(seq 1 50); do
+        head -c 20000 /dev/urandom > "app/bin/file$i.bin"
+    done
+    breadcrumb app/app.hbc <<'HBC'
+    <Files Path="./bin/*.bin" Destination="$(OUTPUT_DIR)" />
+HBC
+
+    # Processes which add the same objects at the same time, each one through its own temporary files
+    local pids=()
+    for i in 1 2 3 4; do
+        hansel --install app/app.hbc "out$i" linux64 -e OUTPUT_DIR="out$i" --store store -j 4 > "log$i" &
+        pids+=($!)
+    done
+    for i in 1 2 3 4; do
+        wait "${pids[$((i - 1))]}" || fail "install $i failed: $(cat "log$i")"
+        assert_eq "$(tree_of app/bin)" "$(tree_of "out$i/linux64")" "unexpected files in out$i"
+    done
+    assert_eq "" "$(find store -name '*.tmp*')"
+}
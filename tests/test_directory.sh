@@ -0,0 +1,26 @@
+# Copy of <Directory> dependencies (see Utilities::CopyDirectory() and DirectoryStream)
+
+test_directory_copies_the_whole_tree()
+{
+    make_file app/assets/a.txt
+    make_file app/assets/sub/b.txt
+    make_file app/assets/sub/deeper/c.txt
+    mkdir -p app/assets/empty
+    breadcrumb app/app.hbc <<'HBC'
+    <Directory Path="./assets" Destination="$(OUTPUT_DIR)/assets" />
+HBC
+    local output
+    output=$(hansel --install app/app.hbc out linux64 -e OUTPUT_DIR=out -j 4) || fail "install failed: $output"
+    assert_eq "$(tree_of app/assets)" "$(tree_of out/linux64/assets)"
+    [ -d out/linux64/assets/empty ] || fail "the empty directory has not been copied"
+}
+
+test_directory_missing_source()
+{
+    breadcrumb app/app.hbc <<'HBC'
+    <Directory Path="./missing" Destination="$(OUTPUT_DIR)/assets" />
+HBC
+    local output
+    output=$(hansel --install app/app.hbc out linux64 -e OUTPUT_DIR=out) && fail "install succeeded: $output"
+    assert_contains "$output" "No such file or directory"
+}
@@ -0,0 +1,78 @@
+# Fallbacks between the copy mechanisms of FileCopier (Linux only)
+
+# Builds a library which makes reflinks unsupported, and copy_file_range() fail with EXDEV after copying
+#  a first part of each file, so that copies continue with sendfile() from the middle of the file
+build_fallback_shim()
+{
+    [ "$(uname -s)" == "Linux" ] || skip "Linux only"
+    command -v cc > /dev/null || skip "no C compiler to build the preloaded library"
+
+    cat > shim.c <<'C'
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <errno.h>
+#include <linux/fs.h>
+#include <stdarg.h>
+#include <sys/types.h>
+
+int ioctl(int fd, unsigned long request, ...)
+{
+    va_list arguments;
+    va_start(arguments, request);
+    void* argument = va_arg(arguments, void*);
+    va_end(arguments);
+
+    if (request == FICLONE)
+    {
+        errno = EOPNOTSUPP;
+        return -1;
+    }
+    int (*real_ioctl)(int, unsigned long, ...) = dlsym(RTLD_NEXT, "ioctl");
+    return real_ioctl(fd, request, argument);
+}
+
+ssize_t copy_file_range(int fd_in, loff_t* off_in, int fd_out, loff_t* off_out, size_t length, unsigned int flags)
+{
+    static __thread int calls = 0;
+    if (calls++ % 2 == 1)
+    {
+        errno = EXDEV;
+        return -1;
+    }
+    ssize_t (*real_copy_file_range)(int, loff_t*, int, loff_t*, size_t, unsigned int) = dlsym(RTLD_NEXT, "copy_file_range");
+    return real_copy_file_range(fd_in, off_in, fd_out, off_out, length < 5000 ? length : 5000, flags);
+}
+C
+    cc -shared -fPIC -o shim.so shim.c -ldl || skip "unable to build the preloaded library"
+}
+
+test_file_copier_continues_with_sendfile()
+{
+    build_fallback_shim
+    head -c 300000 /dev/urandom > random.bin
+    make_file app/bin/small.txt "small"
+    cp random.bin app/bin/large.bin
+    breadcrumb app/app.hbc <<'HBC'
+    <Files Path="./bin/*" Destination="$(OUTPUT_DIR)" />
+HBC
+    local output
+    output=$(LD_PRELOAD=$PWD/shim.so hansel --install app/app.hbc out linux64 -e OUTPUT_DIR=out -v) || fail "install failed: $output"
+    assert_contains "$output" "sendfile"
+    cmp random.bin out/linux64/large.bin || fail "the copy of large.bin differs from its source"
+    assert_file out/linux64/small.txt small
+}
+
+test_file_copier_overwrites_larger_destination()
+{
+    build_fallback_shim
+    head -c 300000 /dev/urandom > random.bin
+    mkdir -p app/bin out/linux64
+    head -c 100000 /dev/urandom > app/bin/data.bin
+    cp random.bin out/linux64/data.bin
+    breadcrumb app/app.hbc <<'HBC'
+    <Files Path="./bin/*" Destination="$(OUTPUT_DIR)" />
+HBC
+    local output
+    output=$(LD_PRELOAD=$PWD/shim.so hansel --install app/app.hbc out linux64 -e OUTPUT_DIR=out) || fail "install failed: $output"
+    cmp app/bin/data.bin out/linux64/data.bin || fail "the copy of data.bin differs from its source"
+}
@@ -0,0 +1,35 @@
+# Wildcard patterns of <Files> nodes (see GlobPattern)
+
+test_files_pattern_matches_file_names()
+{
+    make_file app/bin/libfoo.so
+    make_file app/bin/libbar.so.1
+    make_file app/bin/other.so
+    make_file app/bin/libfoo.a
+    breadcrumb app/app.hbc <<'HBC'
+    <Files Path="./bin/lib*.so*" Destination="$(OUTPUT_DIR)" />
+HBC
+    local output
+    output=$(hansel --install app/app.hbc out linux64 -e OUTPUT_DIR=out) || fail "install failed: $output"
+    assert_file out/linux64/libfoo.so
+    assert_file out/linux64/libbar.so.1
+    assert_no_file out/linux64/other.so
+    assert_no_file out/linux64/libfoo.a
+}
+
+test_files_pattern_character_classes()
+{
+    make_file app/data/a1.txt
+    make_file app/data/b2.txt
+    make_file app/data/c3.txt
+    make_file app/data/]x.txt
+    breadcrumb app/app.hbc <<'HBC'
+    <Files Path="./data/[!a]?.txt" Destination="$(OUTPUT_DIR)/negated" />
+    <Files Path="./data/[a-b]*.txt" Destination="$(OUTPUT_DIR)/range" />
+    <Files Path="./data/[]]*.txt" Destination="$(OUTPUT_DIR)/bracket" />
+HBC
+    local output
+    output=$(hansel --install app/app.hbc out linux64 -e OUTPUT_DIR=out) || fail "install failed: $output"
+    assert_eq "./bracket/]x.txt ./negated/]x.txt ./negated/b2.txt ./negated/c3.txt ./range/a1.txt ./range/b2.txt" \
+        "$(cd out/linux64 && find . -type f ! -name '.hansel-*' | LC_ALL=C sort | xargs)"
+}
@@ -0,0 +1,31 @@
+# Files generated by commands, which are installed by the dependencies that follow them (see InstallPlan)
+
+test_generated_files_are_installed_after_the_command()
+{
+    breadcrumb app/app.hbc <<'HBC'
+    <Command Code="mkdir -p app/gen/sub &amp;&amp; echo one &gt; app/gen/one.txt &amp;&amp; echo two &gt; app/gen/sub/two.txt" />
+    <Files Path="./gen/**/*.txt" Destination="$(OUTPUT_DIR)/files" />
+HBC
+    local output jobs
+    for jobs in 1 4; do
+        rm -rf app/gen out
+        output=$(hansel --install app/app.hbc out linux64 -e OUTPUT_DIR=out -j $jobs) || fail "install failed: $output"
+        assert_file out/linux64/files/one.txt one
+        assert_file out/linux64/files/sub/two.txt two
+    done
+}
+
+test_generated_files_missing_directory()
+{
+    breadcrumb app/app.hbc <<'HBC'
+    <Command Code="true" />
+    <Files Path="./missing/*.txt" Destination="$(OUTPUT_DIR)" />
+    <File Path="./app.hbc" Destination="$(OUTPUT_DIR)" />
+HBC
+    local output
+    # The error of the expansion is reported, and doesn't stop the other actions
+    output=$(hansel --install app/app.hbc out linux64 -e OUTPUT_DIR=out -j 4) && fail "install succeeded: $output"
+    assert_contains "$output" "[ERROR]"
+    assert_contains "$output" "missing"
+    assert_file out/linux64/app.hbc
+}
@@ -0,0 +1,56 @@
+# Installation of links with --link-mode, and their checks
+
+link_breadcrumb()
+{
+    make_file app/bin/a.so "a"
+    make_file app/bin/b.so "b"
+    breadcrumb app/app.hbc <<'HBC'
+    <Files Path="./bin/*.so" Destination="$(OUTPUT_DIR)" />
+HBC
+}
+
+test_link_mode_symlink()
+{
+    link_breadcrumb
+    local output
+    output=$(hansel --install app/app.hbc out linux64 -e OUTPUT_DIR=out --link-mode symlink) || fail "install failed: $output"
+    [ -L out/linux64/a.so ] || fail "out/linux64/a.so is not a symbolic link"
+    assert_file out/linux64/a.so a
+
+    # Copying again replaces the links instead of writing through them
+    output=$(hansel --install app/app.hbc out linux64 -e OUTPUT_DIR=out) || fail "install failed: $output"
+    [ ! -L out/linux64/a.so ] || fail "out/linux64/a.so is still a symbolic link"
+    make_file out/linux64/a.so "changed"
+    assert_file app/bin/a.so a
+}
+
+test_link_mode_check_links_are_up_to_date()
+{
+    link_breadcrumb
+    local output
+    output=$(hansel --install app/app.hbc out linux64 -e OUTPUT_DIR=out --link-mode symlink) || fail "install failed: $output"
+    output=$(hansel --check app/app.hbc out linux64 -e OUTPUT_DIR=out -v) || fail "check failed: $output"
+    assert_contains "$output" "Installed files: 2 up-to-date (2 links to their sources), 0 out-of-date, 0 missing"
+
+    # Hard links are found as well, whatever the link mode of the check
+    rm -rf out
+    output=$(hansel --install app/app.hbc out linux64 -e OUTPUT_DIR=out --link-mode hardlink) || fail "install failed: $output"
+    output=$(hansel --check app/app.hbc out linux64 -e OUTPUT_DIR=out -v) || fail "check failed: $output"
+    assert_contains "$output" "Installed files: 2 up-to-date (2 links to their sources), 0 out-of-date, 0 missing"
+}
+
+test_link_mode_check_copies()
+{
+    link_breadcrumb
+    local output
+    output=$(hansel --install app/app.hbc out linux64 -e OUTPUT_DIR=out) || fail "install failed: $output"
+    output=$(hansel --check app/app.hbc out linux64 -e OUTPUT_DIR=out -v) || fail "check failed: $output"
+    assert_contains "$output" "Installed files: 2 up-to-date (0 links to their sources), 0 out-of-date, 0 missing"
+
+    make_file app/bin/a.so "a2"
+    touch -d '2001-01-01' app/bin/a.so
+    rm out/linux64/b.so
+    output=$(hansel --check app/app.hbc out linux64 -e OUTPUT_DIR=out -v) || fail "check failed: $output"
+    assert_contains "$output" "is out-of-date"
+    assert_contains "$output" "Installed files: 0 up-to-date (0 links to their sources), 1 out-of-date, 1 missing"
+}
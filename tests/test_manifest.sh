@@ -0,0 +1,75 @@
+# Incremental installations with the install manifest (see InstallManifest)
+
+manifest_breadcrumb()
+{
+    make_file app/bin/a.so "a"
+    make_file app/bin/b.so "b"
+    breadcrumb app/app.hbc <<'HBC'
+    <Files Path="./bin/*.so" Destination="$(OUTPUT_DIR)" />
+HBC
+}
+
+install_app()
+{
+    hansel --install app/app.hbc out linux64 -e OUTPUT_DIR=out -v "$@"
+}
+
+test_manifest_skips_up_to_date_files()
+{
+    manifest_breadcrumb
+    local output
+    output=$(install_app) || fail "install failed: $output"
+    assert_contains "$output" "Install manifest: 0 files up-to-date, 2 installed"
+    assert_file out/.hansel-manifest
+
+    output=$(install_app) || fail "install failed: $output"
+    assert_contains "$output" "Install manifest: 2 files up-to-date, 0 installed"
+    assert_file out/linux64/a.so a
+}
+
+test_manifest_copies_modified_files_again()
+{
+    manifest_breadcrumb
+    local output
+    output=$(install_app) || fail "install failed: $output"
+
+    # A modified source, and a destination modified (or removed) since the installation
+    make_file app/bin/a.so "a2"
+    touch -d '2001-01-01' app/bin/a.so
+    make_file out/linux64/b.so "local change"
+    output=$(install_app) || fail "install failed: $output"
+    assert_contains "$output" "Install manifest: 0 files up-to-date, 2 installed"
+    assert_file out/linux64/a.so a2
+    assert_file out/linux64/b.so b
+
+    rm out/linux64/a.so
+    output=$(install_app) || fail "install failed: $output"
+    assert_contains "$output" "Install manifest: 1 files up-to-date, 1 installed"
+    assert_file out/linux64/a.so a2
+}
+
+test_manifest_force()
+{
+    manifest_breadcrumb
+    local output
+    output=$(install_app) || fail "install failed: $output"
+    output=$(install_app --force) || fail "install failed: $output"
+    assert_contains "$output" "Install manifest: 0 files up-to-date, 2 installed"
+
+    # The manifest is still updated by a forced installation
+    output=$(install_app) || fail "install failed: $output"
+    assert_contains "$output" "Install manifest: 2 files up-to-date, 0 installed"
+}
+
+test_manifest_corrupted()
+{
+    manifest_breadcrumb
+    local output
+    output=$(install_app) || fail "install failed: $output"
+    sed -i 's/\t[0-9]\t/\tx\t/' out/.hansel-manifest
+    output=$(install_app) || fail "install failed: $output"
+    assert_contains "$output" "is corrupted and will be re-generated"
+    assert_contains "$output" "Install manifest: 0 files up-to-date, 2 installed"
+    output=$(install_app) || fail "install failed: $output"
+    assert_contains "$output" "Install manifest: 2 files up-to-date, 0 installed"
+}
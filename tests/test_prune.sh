@@ -0,0 +1,103 @@
+# Removal of the files which are not installed anymore with --prune (see InstallManifest::Prune())
+
+prune_install()
+{
+    hansel --install app/app.hbc out linux64 -e OUTPUT_DIR=out --prune "$@"
+}
+
+test_prune_removes_stale_files()
+{
+    make_file app/lib/a.so
+    make_file app/lib/b.so
+    make_file app/assets/x.txt
+    breadcrumb app/app.hbc <<'HBC'
+    <Files Path="./lib/*.so" Destination="$(OUTPUT_DIR)/lib" />
+    <Directory Path="./assets" Destination="$(OUTPUT_DIR)/assets" />
+HBC
+    local output
+    output=$(prune_install) || fail "install failed: $output"
+    assert_file out/linux64/lib/b.so
+    assert_file out/linux64/assets/x.txt
+
+    # A file removed from the library, and one from a copied directory
+    rm app/lib/b.so app/assets/x.txt
+    make_file app/assets/y.txt
+    output=$(prune_install) || fail "install failed: $output"
+    assert_file out/linux64/lib/a.so
+    assert_no_file out/linux64/lib/b.so
+    assert_no_file out/linux64/assets/x.txt
+    assert_file out/linux64/assets/y.txt
+}
+
+test_prune_removes_empty_directories()
+{
+    make_file app/lib/a.so
+    make_file app/plugins/sub/p.so
+    breadcrumb app/app.hbc <<'HBC'
+    <Files Path="./lib/*.so" Destination="$(OUTPUT_DIR)" />
+    <Directory Path="./plugins" Destination="$(OUTPUT_DIR)/plugins" />
+HBC
+    local output
+    output=$(prune_install) || fail "install failed: $output"
+    assert_file out/linux64/plugins/sub/p.so
+
+    breadcrumb app/app.hbc <<'HBC'
+    <Files Path="./lib/*.so" Destination="$(OUTPUT_DIR)" />
+HBC
+    output=$(prune_install) || fail "install failed: $output"
+    assert_no_file out/linux64/plugins
+    assert_file out/linux64/a.so
+}
+
+test_prune_keeps_modified_files()
+{
+    make_file app/lib/a.so
+    breadcrumb app/app.hbc <<'HBC'
+    <Files Path="./lib/*.so" Destination="$(OUTPUT_DIR)" />
+HBC
+    local output
+    output=$(prune_install) || fail "install failed: $output"
+    make_file out/linux64/a.so "local change"
+    rm app/lib/a.so
+    output=$(prune_install) || fail "install failed: $output"
+    assert_contains "$output" "has been modified since it was installed and will not be removed"
+    assert_file out/linux64/a.so "local change"
+}
+
+test_prune_compares_normalized_destinations()
+{
+    make_file app/lib/a.so
+    breadcrumb app/app.hbc <<'HBC'
+    <File Path="./lib/a.so" Destination="$(OUTPUT_DIR)/bin" />
+HBC
+    local output
+    output=$(prune_install) || fail "install failed: $output"
+
+    # The same destination, spelled differently
+    breadcrumb app/app.hbc <<'HBC'
+    <File Path="./lib/a.so" Destination="$(OUTPUT_DIR)/./bin/" />
+HBC
+    output=$(prune_install) || fail "install failed: $output"
+    assert_file out/linux64/bin/a.so
+}
+
+test_prune_skipped_after_failure()
+{
+    make_file app/lib/a.so
+    make_file app/lib/b.so
+    breadcrumb app/app.hbc <<'HBC'
+    <Files Path="./lib/*.so" Destination="$(OUTPUT_DIR)" />
+HBC
+    local output
+    output=$(prune_install) || fail "install failed: $output"
+
+    # b.so is not part of the new installation, but nothing is removed after a failure
+    breadcrumb app/app.hbc <<'HBC'
+    <Command Code="false" />
+    <Files Path="./lib/a.so" Destination="$(OUTPUT_DIR)" />
+HBC
+    output=$(prune_install) && fail "install succeeded: $output"
+    assert_contains "$output" "The installation has failed, stale files are not removed"
+    assert_file out/linux64/a.so
+    assert_file out/linux64/b.so
+}
@@ -0,0 +1,51 @@
+# Removal of the copies which repeat a previous one from the install plan (see InstallPlan::IsRedundantCopy())
+
+test_redundant_copies_are_removed()
+{
+    make_file app/lib/a.so "aaaa"
+    make_file app/assets/x.txt
+    breadcrumb app/app.hbc <<'HBC'
+    <File Path="./lib/a.so" Destination="$(OUTPUT_DIR)" />
+    <Directory Path="./assets" Destination="$(OUTPUT_DIR)/assets" />
+    <File Path="./lib/a.so" Destination="$(OUTPUT_DIR)" />
+    <Directory Path="./assets" Destination="$(OUTPUT_DIR)/assets" />
+HBC
+    local output
+    output=$(hansel --install app/app.hbc out linux64 -e OUTPUT_DIR=out -v) || fail "install failed: $output"
+    assert_contains "$output" "1 redundant file copies (5 bytes) and 1 directory copies removed"
+    assert_file out/linux64/a.so "aaaa"
+    assert_file out/linux64/assets/x.txt
+}
+
+test_redundant_copies_keep_later_writes()
+{
+    make_file app/lib/a.so "first"
+    make_file app/other/a.so "second"
+    breadcrumb app/app.hbc <<'HBC'
+    <File Path="./lib/a.so" Destination="$(OUTPUT_DIR)" />
+    <File Path="./other/a.so" Destination="$(OUTPUT_DIR)" />
+    <File Path="./lib/a.so" Destination="$(OUTPUT_DIR)" />
+HBC
+    local output
+    output=$(hansel --install app/app.hbc out linux64 -e OUTPUT_DIR=out -v -j 4) || fail "install failed: $output"
+
+    # The destination has been overwritten in between, the last copy is still needed
+    assert_contains "$output" "0 redundant file copies (0 bytes)"
+    assert_file out/linux64/a.so "first"
+}
+
+test_redundant_copies_across_commands()
+{
+    make_file app/lib/a.so "first"
+    breadcrumb app/app.hbc <<'HBC'
+    <File Path="./lib/a.so" Destination="$(OUTPUT_DIR)" />
+    <Command Code="echo changed &gt; out/linux64/a.so" />
+    <File Path="./lib/a.so" Destination="$(OUTPUT_DIR)" />
+HBC
+    local output
+    output=$(hansel --install app/app.hbc out linux64 -e OUTPUT_DIR=out -v --force) || fail "install failed: $output"
+
+    # Nothing is known of what the command has done
+    assert_contains "$output" "0 redundant file copies (0 bytes)"
+    assert_file out/linux64/a.so "first"
+}
@@ -0,0 +1,90 @@
+# Commands skipped by their stamps (see CommandStamps)
+
+# Writes a breadcrumb with a command which counts its runs, and creates its input
+#  Usage: stamped_command [Outputs attribute]
+stamped_command()
+{
+    make_file app/config.in
+    breadcrumb app/app.hbc <<HBC
+    <Command Code="echo run &gt;&gt; runs; [ ! -f fail ] &amp;&amp; mkdir -p \$(OUTPUT_DIR) &amp;&amp; cp app/config.in \$(OUTPUT_DIR)/config.ini" Inputs="./config.in" Outputs="${1:-\$(OUTPUT_DIR)/config.ini}" />
+HBC
+}
+
+# Installs the application, and prints the number of runs of the command
+install_stamped_app()
+{
+    local output
+    output=$(hansel --install app/app.hbc out linux64 -e OUTPUT_DIR=out -v "$@") || fail "install failed: $output"
+    wc -l < runs | tr -d ' '
+}
+
+test_stamps_skip_up_to_date_command()
+{
+    stamped_command
+    assert_eq "$(install_stamped_app)" 1
+    local output
+    output=$(hansel --install app/app.hbc out linux64 -e OUTPUT_DIR=out -v) || fail "install failed: $output"
+    assert_contains "$output" "Skipping command"
+    assert_contains "$output" "Command stamps: 1 commands up-to-date, 0 executed"
+    assert_eq "$(wc -l < runs | tr -d ' ')" 1
+}
+
+test_stamps_input_change()
+{
+    stamped_command
+    assert_eq "$(install_stamped_app)" 1
+    printf 'changed\n' > app/config.in
+    assert_eq "$(install_stamped_app)" 2
+    assert_file out/linux64/config.ini changed
+}
+
+test_stamps_missing_output()
+{
+    stamped_command
+    assert_eq "$(install_stamped_app)" 1
+    rm out/linux64/config.ini
+    assert_eq "$(install_stamped_app)" 2
+    assert_file out/linux64/config.ini app/config.in
+}
+
+test_stamps_force()
+{
+    stamped_command
+    assert_eq "$(install_stamped_app)" 1
+    assert_eq "$(install_stamped_app --force)" 2
+    # The stamps are still updated with --force
+    assert_eq "$(install_stamped_app)" 2
+}
+
+test_stamps_failed_run()
+{
+    stamped_command
+    touch fail
+    local output
+    output=$(hansel --install app/app.hbc out linux64 -e OUTPUT_DIR=out) && fail "install succeeded: $output"
+    rm fail
+    assert_eq "$(install_stamped_app)" 2
+    assert_eq "$(install_stamped_app)" 2
+}
+
+test_stamps_declared_outputs_change()
+{
+    stamped_command
+    assert_eq "$(install_stamped_app)" 1
+    # Same command line and inputs, but another declared output (which exists)
+    stamped_command ./config.in
+    assert_eq "$(install_stamped_app)" 2
+}
+
+test_stamps_corrupted()
+{
+    stamped_command
+    assert_eq "$(install_stamped_app)" 1
+    assert_file out/.hansel-stamps
+    printf 'I\tnot-a-hash\t./config.in\n' >> out/.hansel-stamps
+    local output
+    output=$(hansel --install app/app.hbc out linux64 -e OUTPUT_DIR=out -v) || fail "install failed: $output"
+    assert_contains "$output" "is corrupted and will be re-generated"
+    assert_eq "$(wc -l < runs | tr -d ' ')" 2
+    assert_eq "$(install_stamped_app)" 2
+}
@@ -0,0 +1,32 @@
+# Variable substitution in attribute values (see AttributeTemplate)
+
+test_substitution_of_variables()
+{
+    breadcrumb app/app.hbc <<'HBC'
+    <Command Code="echo [$(MY_VAR)] [$(my_var)] [$(PLATFORM_DIR)]" />
+HBC
+    local output
+    output=$(hansel --list app/app.hbc linux64 -e MY_VAR=yes) || fail "list failed: $output"
+    assert_contains "$output" "[COMMAND] echo [yes] [yes] [linux64]"
+}
+
+test_substitution_rescans_substituted_values()
+{
+    # The original regex-based substitution scanned the whole value again after each replacement
+    breadcrumb app/app.hbc <<'HBC'
+    <Command Code="echo [$($(NAME))]" />
+HBC
+    local output
+    output=$(hansel --list app/app.hbc linux64 -e NAME=MY_VAR MY_VAR=yes) || fail "list failed: $output"
+    assert_contains "$output" "[COMMAND] echo [yes]"
+}
+
+test_substitution_of_undefined_variable()
+{
+    breadcrumb app/app.hbc <<'HBC'
+    <Command Code="echo $(UNDEFINED)" />
+HBC
+    local output
+    output=$(hansel --list app/app.hbc linux64) && fail "list succeeded: $output"
+    assert_contains "$output" "Cannot substitute \$(UNDEFINED), variable not defined"
+}